@@ -43,21 +43,22 @@
 #define Label(_NAME_) @{ OEGameCoreDisplayModeLabelKey : _NAME_, }
 #define SeparatorItem() @{ OEGameCoreDisplayModeSeparatorItemKey : @"",}
 
-gambatte::GB gb;
-Resampler *resampler;
-uint32_t pad[OEGBButtonCount];
-
 class GetInput : public gambatte::InputGetter
 {
 public:
+    uint32_t pad[OEGBButtonCount];
+
     unsigned operator()()
     {
         return pad[0];
     }
-} static GetInput;
+};
 
 @interface GBGameCore () <OEGBSystemResponderClient>
 {
+    gambatte::GB _gb;
+    Resampler *_resampler;
+    GetInput _input;
     uint32_t *_videoBuffer;
     uint32_t *_inSoundBuffer;
     int16_t *_outSoundBuffer;
@@ -83,8 +84,8 @@ public:
 {
     if((self = [super init]))
     {
-        _inSoundBuffer = (uint32_t *)malloc(2064 * 2 * 4);
-        _outSoundBuffer = (int16_t *)malloc(2064 * 2 * 2);
+        _inSoundBuffer = (uint32_t *)malloc(gambatte::GB::runFramesAudioSize(1) * 4);
+        _outSoundBuffer = (int16_t *)malloc(gambatte::GB::runFramesAudioSize(1) * 2 * 2);
         _cheatList = [NSMutableDictionary dictionary];
     }
 
@@ -102,30 +103,30 @@ public:
 
 - (BOOL)loadFileAtPath:(NSString *)path error:(NSError **)error
 {
-    memset(pad, 0, sizeof(pad));
+    memset(_input.pad, 0, sizeof(_input.pad));
 
     // Set battery save dir
     NSURL *batterySavesDirectory = [NSURL fileURLWithPath:self.batterySavesDirectoryPath];
     [[NSFileManager defaultManager] createDirectoryAtURL:batterySavesDirectory withIntermediateDirectories:YES attributes:nil error:nil];
-    gb.setSaveDir(batterySavesDirectory.fileSystemRepresentation);
+    _gb.setSaveDir(batterySavesDirectory.fileSystemRepresentation);
 
     // Set input state callback
-    gb.setInputGetter(&GetInput);
+    _gb.setInputGetter(&_input);
 
     // Setup resampler
     double fps = 4194304.0 / 70224.0;
     double inSampleRate = fps * 35112; // 2097152
 
     // 2 = "Very high quality (polyphase FIR)", see resamplerinfo.cpp
-    resampler = ResamplerInfo::get(2).create(inSampleRate, 48000.0, 2 * 2064);
+    _resampler = ResamplerInfo::get(2).create(inSampleRate, 48000.0, gambatte::GB::runFramesAudioSize(1));
 
     unsigned long mul, div;
-    resampler->exactRatio(mul, div);
+    _resampler->exactRatio(mul, div);
 
     double outSampleRate = inSampleRate * mul / div;
     _sampleRate = outSampleRate; // 47994.326636
 
-    if (gb.load(path.fileSystemRepresentation) != 0)
+    if (_gb.load(path.fileSystemRepresentation) != 0)
         return NO;
 
     [self loadDisplayModeOptions];
@@ -135,26 +136,21 @@ public:
 
 - (void)executeFrame
 {
-    size_t samples = 2064;
-
-    while (gb.runFor(_videoBuffer, 160, _inSoundBuffer, samples) == -1) {
-        [self outputAudio:samples];
-        samples = 2064;
-    }
-
+    size_t samples;
+    _gb.runFrames(1, _videoBuffer, 160, 0, _inSoundBuffer, samples);
     [self outputAudio:samples];
 }
 
 - (void)resetEmulation
 {
-    gb.reset();
+    _gb.reset();
 }
 
 - (void)stopEmulation
 {
-    gb.saveSavedata();
+    _gb.saveSavedata();
 
-    delete resampler;
+    delete _resampler;
 
     [super stopEmulation];
 }
@@ -216,13 +212,13 @@ public:
 
 - (void)saveStateToFileAtPath:(NSString *)fileName completionHandler:(void (^)(BOOL, NSError *))block
 {
-    int success = gb.saveState(0, 0, fileName.fileSystemRepresentation);
+    int success = _gb.saveState(0, 0, fileName.fileSystemRepresentation);
     if(block) block(success==1, nil);
 }
 
 - (void)loadStateFromFileAtPath:(NSString *)fileName completionHandler:(void (^)(BOOL, NSError *))block
 {
-    int success = gb.loadState(fileName.fileSystemRepresentation);
+    int success = _gb.loadState(fileName.fileSystemRepresentation);
     if(block) block(success==1, nil);
 }
 
@@ -230,7 +226,7 @@ public:
 {
     std::stringstream stream(std::ios::in|std::ios::out|std::ios::binary);
 
-    if(gb.serializeState(stream)) {
+    if(_gb.serializeState(stream)) {
         stream.seekg(0, std::ios::end);
         NSUInteger length = stream.tellg();
         stream.seekg(0, std::ios::beg);
@@ -259,7 +255,7 @@ public:
     std::streamsize size = state.length;
     stream.write(bytes, size);
 
-    if(gb.deserializeState(stream))
+    if(_gb.deserializeState(stream))
         return YES;
 
     if(outError) {
@@ -276,12 +272,12 @@ public:
 const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gambatte::InputGetter::LEFT, gambatte::InputGetter::RIGHT, gambatte::InputGetter::A, gambatte::InputGetter::B, gambatte::InputGetter::START, gambatte::InputGetter::SELECT};
 - (oneway void)didPushGBButton:(OEGBButton)button;
 {
-    pad[0] |= GBMap[button];
+    _input.pad[0] |= GBMap[button];
 }
 
 - (oneway void)didReleaseGBButton:(OEGBButton)button;
 {
-    pad[0] &= ~GBMap[button];
+    _input.pad[0] &= ~GBMap[button];
 }
 
 #pragma mark - Cheats
@@ -335,7 +331,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
 
         NSArray <NSDictionary <NSString *, id> *> *availableModesWithDefault;
 
-        if (gb.isCgb())
+        if (_gb.isCgb())
         {
             availableModesWithDefault =
             @[
@@ -371,7 +367,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
         // Deep mutable copy
         _availableDisplayModes = (NSMutableArray *)CFBridgingRelease(CFPropertyListCreateDeepCopy(kCFAllocatorDefault, (CFArrayRef)availableModesWithDefault, kCFPropertyListMutableContainers));
 
-        if (!gb.isCgb() && ![self gameHasInternalPalette])
+        if (!_gb.isCgb() && ![self gameHasInternalPalette])
             [_availableDisplayModes removeObjectAtIndex:0];
     }
 
@@ -467,7 +463,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
     if ([displayModePrefKey isEqualToString:@"palette"])
         [self changePalette:displayMode];
     else if ([displayModePrefKey isEqualToString:@"colorCorrection"])
-        gb.setCgbColorCorrection([displayMode isEqual:@"Modern"] ? 1 : 0);
+        _gb.setCgbColorCorrection([displayMode isEqual:@"Modern"] ? 1 : 0);
 }
 
 # pragma mark - Misc Helper Methods
@@ -477,7 +473,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
     if (!frames)
         return;
 
-    size_t len = resampler->resample(_outSoundBuffer, reinterpret_cast<const int16_t *>(_inSoundBuffer), frames);
+    size_t len = _resampler->resample(_outSoundBuffer, reinterpret_cast<const int16_t *>(_inSoundBuffer), frames);
 
     if (len)
         [[self audioBufferAtIndex:0] write:_outSoundBuffer maxLength:len << 2];
@@ -487,14 +483,14 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
 {
     std::string s = [code UTF8String];
     if (s.find("-") != std::string::npos)
-        gb.setGameGenie(s);
+        _gb.setGameGenie(s);
     else
-        gb.setGameShark(s);
+        _gb.setGameShark(s);
 }
 
 - (void)loadDisplayModeOptions
 {
-    if (gb.isCgb())
+    if (_gb.isCgb())
     {
         // Restore color correction
         NSString *lastColorCorrection = self.displayModeInfo[@"colorCorrection"] ?: @"Default";
@@ -509,7 +505,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
 
 - (NSString *)gameInternalName
 {
-    NSString *title = [NSString stringWithUTF8String:gb.romTitle().c_str()];
+    NSString *title = [NSString stringWithUTF8String:_gb.romTitle().c_str()];
     return title;
 }
 
@@ -587,48 +583,48 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
     else if ([palette isEqualToString:@"Greenscale"])
     {
         // GB Pea Soup Green
-        gb.setDmgPaletteColor(0, 0, 8369468);
-        gb.setDmgPaletteColor(0, 1, 6728764);
-        gb.setDmgPaletteColor(0, 2, 3629872);
-        gb.setDmgPaletteColor(0, 3, 3223857);
-        gb.setDmgPaletteColor(1, 0, 8369468);
-        gb.setDmgPaletteColor(1, 1, 6728764);
-        gb.setDmgPaletteColor(1, 2, 3629872);
-        gb.setDmgPaletteColor(1, 3, 3223857);
-        gb.setDmgPaletteColor(2, 0, 8369468);
-        gb.setDmgPaletteColor(2, 1, 6728764);
-        gb.setDmgPaletteColor(2, 2, 3629872);
-        gb.setDmgPaletteColor(2, 3, 3223857);
+        _gb.setDmgPaletteColor(0, 0, 8369468);
+        _gb.setDmgPaletteColor(0, 1, 6728764);
+        _gb.setDmgPaletteColor(0, 2, 3629872);
+        _gb.setDmgPaletteColor(0, 3, 3223857);
+        _gb.setDmgPaletteColor(1, 0, 8369468);
+        _gb.setDmgPaletteColor(1, 1, 6728764);
+        _gb.setDmgPaletteColor(1, 2, 3629872);
+        _gb.setDmgPaletteColor(1, 3, 3223857);
+        _gb.setDmgPaletteColor(2, 0, 8369468);
+        _gb.setDmgPaletteColor(2, 1, 6728764);
+        _gb.setDmgPaletteColor(2, 2, 3629872);
+        _gb.setDmgPaletteColor(2, 3, 3223857);
         return;
     }
     else if ([palette isEqualToString:@"Pocket"])
     {
         // GB Pocket
-        gb.setDmgPaletteColor(0, 0, 13487791);
-        gb.setDmgPaletteColor(0, 1, 10987158);
-        gb.setDmgPaletteColor(0, 2, 6974033);
-        gb.setDmgPaletteColor(0, 3, 2828823);
-        gb.setDmgPaletteColor(1, 0, 13487791);
-        gb.setDmgPaletteColor(1, 1, 10987158);
-        gb.setDmgPaletteColor(1, 2, 6974033);
-        gb.setDmgPaletteColor(1, 3, 2828823);
-        gb.setDmgPaletteColor(2, 0, 13487791);
-        gb.setDmgPaletteColor(2, 1, 10987158);
-        gb.setDmgPaletteColor(2, 2, 6974033);
-        gb.setDmgPaletteColor(2, 3, 2828823);
-
-//        gb.setDmgPaletteColor(0, 0, 13029285);
-//        gb.setDmgPaletteColor(0, 1, 9213547);
-//        gb.setDmgPaletteColor(0, 2, 4870457);
-//        gb.setDmgPaletteColor(0, 3, 1580056);
-//        gb.setDmgPaletteColor(1, 0, 13029285);
-//        gb.setDmgPaletteColor(1, 1, 9213547);
-//        gb.setDmgPaletteColor(1, 2, 4870457);
-//        gb.setDmgPaletteColor(1, 3, 1580056);
-//        gb.setDmgPaletteColor(2, 0, 13029285);
-//        gb.setDmgPaletteColor(2, 1, 9213547);
-//        gb.setDmgPaletteColor(2, 2, 4870457);
-//        gb.setDmgPaletteColor(2, 3, 1580056);
+        _gb.setDmgPaletteColor(0, 0, 13487791);
+        _gb.setDmgPaletteColor(0, 1, 10987158);
+        _gb.setDmgPaletteColor(0, 2, 6974033);
+        _gb.setDmgPaletteColor(0, 3, 2828823);
+        _gb.setDmgPaletteColor(1, 0, 13487791);
+        _gb.setDmgPaletteColor(1, 1, 10987158);
+        _gb.setDmgPaletteColor(1, 2, 6974033);
+        _gb.setDmgPaletteColor(1, 3, 2828823);
+        _gb.setDmgPaletteColor(2, 0, 13487791);
+        _gb.setDmgPaletteColor(2, 1, 10987158);
+        _gb.setDmgPaletteColor(2, 2, 6974033);
+        _gb.setDmgPaletteColor(2, 3, 2828823);
+
+//        _gb.setDmgPaletteColor(0, 0, 13029285);
+//        _gb.setDmgPaletteColor(0, 1, 9213547);
+//        _gb.setDmgPaletteColor(0, 2, 4870457);
+//        _gb.setDmgPaletteColor(0, 3, 1580056);
+//        _gb.setDmgPaletteColor(1, 0, 13029285);
+//        _gb.setDmgPaletteColor(1, 1, 9213547);
+//        _gb.setDmgPaletteColor(1, 2, 4870457);
+//        _gb.setDmgPaletteColor(1, 3, 1580056);
+//        _gb.setDmgPaletteColor(2, 0, 13029285);
+//        _gb.setDmgPaletteColor(2, 1, 9213547);
+//        _gb.setDmgPaletteColor(2, 2, 4870457);
+//        _gb.setDmgPaletteColor(2, 3, 1580056);
         return;
     }
     else
@@ -640,7 +636,7 @@ const int GBMap[] = {gambatte::InputGetter::UP, gambatte::InputGetter::DOWN, gam
         for (unsigned colornum = 0; colornum < 4; ++colornum)
         {
             rgb32 = gbcToRgb32(gbc_bios_palette[palnum * 4 + colornum]);
-            gb.setDmgPaletteColor(palnum, colornum, rgb32);
+            _gb.setDmgPaletteColor(palnum, colornum, rgb32);
         }
     }
 }
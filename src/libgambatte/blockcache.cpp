@@ -0,0 +1,128 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "blockcache.h"
+
+using namespace gambatte;
+
+namespace {
+
+enum OpClass {
+	op_plain,      // decoded and executed from the cache.
+	op_branch,     // decoded, ends the block.
+	op_uncached,   // left to the plain fetch path, ends the block.
+	op_mem,        // decoded, memory load/store that may fuse with a following inc/dec rr.
+	op_incdec_rr   // decoded, may be fused into a preceding op_mem.
+};
+
+unsigned char opSize(unsigned opcode) {
+	switch (opcode) {
+	case 0x01: case 0x08: case 0x11: case 0x21: case 0x31:
+	case 0xC2: case 0xC3: case 0xC4: case 0xCA: case 0xCC: case 0xCD:
+	case 0xD2: case 0xD4: case 0xDA: case 0xDC:
+	case 0xEA: case 0xFA:
+		return 3;
+	case 0x06: case 0x0E: case 0x10: case 0x16: case 0x18: case 0x1E:
+	case 0x20: case 0x26: case 0x28: case 0x2E: case 0x30: case 0x36:
+	case 0x38: case 0x3E:
+	case 0xC6: case 0xCB: case 0xCE: case 0xD6: case 0xDE:
+	case 0xE0: case 0xE6: case 0xE8: case 0xEE:
+	case 0xF0: case 0xF6: case 0xF8: case 0xFE:
+		return 2;
+	}
+
+	return 1;
+}
+
+OpClass opClass(unsigned opcode) {
+	switch (opcode) {
+	// stop, halt and the opcodes that freeze the CPU go through the regular
+	// path, which handles their prefetch and halt subtleties.
+	case 0x10: case 0x76:
+	case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4:
+	case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+		return op_uncached;
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+	case 0xC0: case 0xC2: case 0xC3: case 0xC4: case 0xC7: case 0xC8:
+	case 0xC9: case 0xCA: case 0xCC: case 0xCD: case 0xCF:
+	case 0xD0: case 0xD2: case 0xD4: case 0xD7: case 0xD8: case 0xD9:
+	case 0xDA: case 0xDC: case 0xDF:
+	case 0xE7: case 0xE9: case 0xEF: case 0xF7: case 0xFF:
+		return op_branch;
+	case 0x02: case 0x0A: case 0x12: case 0x1A:
+	case 0x46: case 0x4E: case 0x56: case 0x5E: case 0x7E:
+	case 0x70: case 0x71: case 0x72: case 0x73: case 0x77:
+		return op_mem;
+	case 0x03: case 0x0B: case 0x13: case 0x1B:
+	case 0x23: case 0x2B: case 0x33: case 0x3B:
+		return op_incdec_rr;
+	}
+
+	return op_plain;
+}
+
+} // unnamed namespace.
+
+void BlockCache::setEnabled(bool enable) {
+	if (enable != enabled()) {
+		blocks_.reset(enable ? num_blocks : 0);
+		invalidate();
+	}
+}
+
+void BlockCache::invalidate() {
+	if (enabled()) {
+		for (std::size_t i = 0; i < num_blocks; ++i)
+			blocks_[i].tag = 0;
+	}
+}
+
+void BlockCache::decode(Block &b, unsigned char const *const page, unsigned pc) {
+	// blocks never cross a 4 KiB area, since the next area may be mapped elsewhere.
+	unsigned const areaEnd = (pc | 0xFFF) + 1;
+	OpClass prevClass = op_plain;
+
+	b.tag = page + pc;
+	b.numOps = 0;
+	b.native = 0;
+	b.hits = 0;
+	b.nativeOps = 0;
+	b.nativeLead = 0;
+
+	while (b.numOps < max_block_ops) {
+		unsigned const opcode = page[pc];
+		unsigned const size = opSize(opcode);
+		OpClass const cls = opClass(opcode);
+		if (pc + size > areaEnd || cls == op_uncached)
+			break;
+
+		DecodedOp &op = b.ops[b.numOps++];
+		op.pc = pc;
+		op.opcode = opcode;
+		op.imm[0] = size > 1 ? page[pc + 1] : 0;
+		op.imm[1] = size > 2 ? page[pc + 2] : 0;
+		op.size = size;
+		op.fuse = false;
+
+		if (cls == op_incdec_rr && prevClass == op_mem)
+			b.ops[b.numOps - 2].fuse = true;
+
+		pc += size;
+		prevClass = cls;
+		if (cls == op_branch)
+			break;
+	}
+}
@@ -0,0 +1,90 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "array.h"
+#include "mem/memptrs.h"
+
+namespace gambatte {
+
+// Pre-decoded instruction. The opcode and operand bytes are fetched at decode
+// time, so executing it only needs to account for the fetch cycles. 'fuse' is
+// set on memory loads/stores that are followed by an inc/dec of a register pair
+// (ld a,(hl); inc hl and the like), which the CPU then executes back to back.
+struct DecodedOp {
+	unsigned short pc;
+	unsigned char opcode;
+	unsigned char imm[2];
+	unsigned char size;
+	unsigned char fuse;
+};
+
+// Direct-mapped cache of straight-line runs of guest code, tagged by host
+// address so that each ROM bank gets its own entries. Only code in directly
+// mapped areas (rmem(area) != 0) is cached. Code outside of ROM is checked
+// against the bytes it was decoded from before each instruction, which takes
+// care of self-modifying and reloaded RAM-resident code.
+class BlockCache {
+public:
+	enum { max_block_ops = 16 };
+	enum { num_blocks = 0x400 };
+
+	struct Block {
+		unsigned char const *tag;
+		unsigned char numOps;
+		DecodedOp ops[max_block_ops];
+
+		// recompiled leading ops, see Jit. nativeLead is the number of cycles taken by
+		// those ops before the last one starts.
+		unsigned char const *native;
+		unsigned short hits;
+		unsigned char nativeOps;
+		unsigned char nativeLead;
+	};
+
+	BlockCache() {}
+	bool enabled() const { return blocks_; }
+	void setEnabled(bool enable);
+	void invalidate();
+
+	Block & find(unsigned char const *page, unsigned pc) {
+		unsigned char const *const tag = page + pc;
+		Block &b = blocks_[reinterpret_cast<std::size_t>(tag) & (num_blocks - 1)];
+		if (b.tag != tag)
+			decode(b, page, pc);
+
+		return b;
+	}
+
+	static bool isRom(unsigned pc) { return pc < mm_vram_begin; }
+
+	static bool matches(DecodedOp const &op, unsigned char const *page) {
+		return page[op.pc] == op.opcode
+		    && (op.size < 2 || page[op.pc + 1] == op.imm[0])
+		    && (op.size < 3 || page[op.pc + 2] == op.imm[1]);
+	}
+
+private:
+	SimpleArray<Block> blocks_;
+
+	static void decode(Block &b, unsigned char const *page, unsigned pc);
+};
+
+}
+
+#endif
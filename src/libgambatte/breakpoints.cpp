@@ -0,0 +1,139 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "breakpoints.h"
+#include "mem/memptrs.h"
+
+using namespace gambatte;
+
+namespace {
+
+bool testBit(std::vector<unsigned char> const &bits, std::size_t n) {
+	return !bits.empty() && bits[n >> 3] >> (n & 7) & 1;
+}
+
+// sets or clears bit n, allocating bits for 'size' bits first if needed. returns
+// true if the bit changed.
+bool setBit(std::vector<unsigned char> &bits, std::size_t size, std::size_t n, bool enable) {
+	if (testBit(bits, n) == enable)
+		return false;
+
+	if (bits.empty())
+		bits.resize(size / 8);
+
+	bits[n >> 3] ^= 1 << (n & 7);
+	return true;
+}
+
+bool anyBits(std::vector<unsigned char> const &bits, std::size_t begin, std::size_t end) {
+	if (!bits.empty()) {
+		for (std::size_t i = begin >> 3; i < end >> 3; ++i) {
+			if (bits[i])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+} // unnamed namespace.
+
+bool Breakpoints::code(unsigned const bank, unsigned const p) const {
+	if (p < mm_vram_begin) {
+		return bank < romCode_.size()
+		    && testBit(romCode_[bank], p % rombank_size());
+	}
+
+	return testBit(ramCode_, p);
+}
+
+void Breakpoints::setCode(unsigned const bank, unsigned const p, bool const enable) {
+	bool changed;
+	if (p < mm_vram_begin) {
+		if (bank >= romCode_.size()) {
+			if (!enable)
+				return;
+
+			romCode_.resize(bank + 1);
+		}
+
+		changed = setBit(romCode_[bank], rombank_size(), p % rombank_size(), enable);
+	} else
+		changed = setBit(ramCode_, 0x10000, p, enable);
+
+	if (changed && enable)
+		++numCode_;
+	else if (changed)
+		--numCode_;
+}
+
+void Breakpoints::setWatch(unsigned const p, unsigned const flags) {
+	if (watch_.empty()) {
+		if (!flags)
+			return;
+
+		watch_.resize(0x10000);
+	}
+
+	if (flags && !watch_[p])
+		++numWatch_;
+	else if (!flags && watch_[p])
+		--numWatch_;
+
+	if ((flags & watch_read) && !(watch_[p] & watch_read))
+		++numReadWatch_;
+	else if (!(flags & watch_read) && (watch_[p] & watch_read))
+		--numReadWatch_;
+
+	watch_[p] = flags;
+}
+
+void Breakpoints::clear() {
+	romCode_.clear();
+	ramCode_.clear();
+	watch_.clear();
+	numCode_ = 0;
+	numWatch_ = 0;
+	numReadWatch_ = 0;
+}
+
+unsigned Breakpoints::pageTraps(unsigned const page) const {
+	std::size_t const begin = page << 8, end = begin + 0x100;
+	unsigned traps = 0;
+	if (numCode_) {
+		if (begin < mm_vram_begin) {
+			std::size_t const offset = begin % rombank_size();
+			for (std::size_t bank = 0; bank < romCode_.size(); ++bank) {
+				if (anyBits(romCode_[bank], offset, offset + 0x100)) {
+					traps |= MemPtrs::trap_read;
+					break;
+				}
+			}
+		} else if (anyBits(ramCode_, begin, end))
+			traps |= MemPtrs::trap_read;
+	}
+
+	if (numWatch_) {
+		for (std::size_t p = begin; p < end; ++p) {
+			if (watch_[p] & watch_read)
+				traps |= MemPtrs::trap_read;
+			if (watch_[p] & watch_write)
+				traps |= MemPtrs::trap_write;
+		}
+	}
+
+	return traps;
+}
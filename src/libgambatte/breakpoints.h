@@ -0,0 +1,61 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef BREAKPOINTS_H
+#define BREAKPOINTS_H
+
+#include <vector>
+
+namespace gambatte {
+
+enum BreakReason { break_none, break_pc, break_read, break_write };
+
+// PC breakpoints and memory watchpoints. Nothing on the direct access paths looks
+// here. Instead, the pages holding breakpoints or watchpoints are taken out of the
+// MemPtrs page tables (see pageTraps), which sends every access to them through the
+// slow paths of Memory, and those check the exact address.
+//
+// PC breakpoints in ROM are kept in one bitmap per bank, so that a breakpoint only
+// hits when its bank is the one mapped. Elsewhere they are kept by address.
+class Breakpoints {
+public:
+	enum { watch_read = 1, watch_write = 2 };
+
+	Breakpoints() : numCode_(0), numWatch_(0), numReadWatch_(0) {}
+	bool hasCode() const { return numCode_; }
+	bool hasWatch() const { return numWatch_; }
+	bool hasReadWatch() const { return numReadWatch_; }
+	bool code(unsigned bank, unsigned p) const;
+	void setCode(unsigned bank, unsigned p, bool enable);
+	unsigned watch(unsigned p) const { return numWatch_ ? watch_[p] : 0; }
+	void setWatch(unsigned p, unsigned flags);
+	void clear();
+
+	/** Returns the MemPtrs trap flags page needs for the breakpoints and watchpoints in it. */
+	unsigned pageTraps(unsigned page) const;
+
+private:
+	std::vector<std::vector<unsigned char> > romCode_;
+	std::vector<unsigned char> ramCode_;
+	std::vector<unsigned char> watch_;
+	unsigned long numCode_;
+	unsigned long numWatch_;
+	unsigned long numReadWatch_;
+};
+
+}
+
+#endif
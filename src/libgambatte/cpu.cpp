@@ -19,11 +19,16 @@
 #include "cpu.h"
 #include "memory.h"
 #include "savestate.h"
+#include <algorithm>
 
 namespace gambatte {
 
 CPU::CPU()
 : mem_(Interrupter(sp, pc_, opcode_, prefetched_))
+, jitMismatches_(0)
+, idleCycles_(0)
+, idleCyclesLastFrame_(0)
+, instructions_(0)
 , cycleCounter_(0)
 , pc_(0x100)
 , sp(0xFFFE)
@@ -44,9 +49,20 @@ CPU::CPU()
 }
 
 long CPU::runFor(unsigned long const cycles) {
-	process(cycles);
+	// cached blocks and native code do not fetch opcodes or operands one at a time, so
+	// they are left alone while there are breakpoints or read watchpoints, or the
+	// profiler or trace is on.
+	if (blockCache_.enabled() && !mem_.hasBreakpoints() && !mem_.hasReadWatchpoints()
+			&& !profiler_.enabled() && !trace_.enabled())
+		process<true>(cycles);
+	else
+		process<false>(cycles);
 
 	long const csb = mem_.cyclesSinceBlit(cycleCounter_);
+	if (csb >= 0) {
+		idleCyclesLastFrame_ = idleCycles_;
+		idleCycles_ = 0;
+	}
 
 	if (cycleCounter_ & 0x80000000)
 		cycleCounter_ = mem_.resetCounters(cycleCounter_);
@@ -81,6 +97,80 @@ static inline unsigned  zfFromF(unsigned f) { return ~f & 0x80; }
 static inline unsigned hf2FromF(unsigned f) { return f << 4 & (hf2_subf | hf2_hcf); }
 static inline unsigned  cfFromF(unsigned f) { return f << 4 & 0x100; }
 
+void CPU::setBlockCacheEnabled(bool enable) {
+	if (!enable)
+		jit_.setMode(Jit::mode_off);
+
+	blockCache_.setEnabled(enable);
+	invalidateBlocks();
+}
+
+bool CPU::setJitMode(Jit::Mode mode) {
+	if (!jit_.setMode(mode))
+		return false;
+
+	if (mode != Jit::mode_off)
+		blockCache_.setEnabled(true);
+
+	invalidateBlocks();
+	return true;
+}
+
+bool CPU::setProfilerEnabled(bool enable) {
+#ifdef GAMBATTE_PROFILER
+	profiler_.setEnabled(enable);
+	return true;
+#else
+	return !enable;
+#endif
+}
+
+bool CPU::setTraceSize(std::size_t size) {
+#ifdef GAMBATTE_TRACE
+	trace_.setSize(size);
+	return true;
+#else
+	return !size;
+#endif
+}
+
+void CPU::getJitRegs(JitRegs &regs, unsigned char a) const {
+	regs.hf1 = hf1;
+	regs.hf2 = hf2;
+	regs.zf = zf;
+	regs.cf = cf;
+	regs.sp = sp;
+	regs.a = a;
+	regs.b = b;
+	regs.c = c;
+	regs.d = d;
+	regs.e = e;
+	regs.h = h;
+	regs.l = l;
+}
+
+unsigned char CPU::setJitRegs(JitRegs const &regs) {
+	hf1 = regs.hf1;
+	hf2 = regs.hf2;
+	zf = regs.zf;
+	cf = regs.cf;
+	sp = regs.sp;
+	b = regs.b;
+	c = regs.c;
+	d = regs.d;
+	e = regs.e;
+	h = regs.h;
+	l = regs.l;
+	return regs.a;
+}
+
+static bool sameJitRegs(JitRegs const &x, JitRegs const &y) {
+	return x.a == y.a && x.b == y.b && x.c == y.c && x.d == y.d
+	    && x.e == y.e && x.h == y.h && x.l == y.l && x.sp == y.sp
+	    && toF(updateHf2FromHf1(x.hf1, x.hf2), x.cf, x.zf)
+	    == toF(updateHf2FromHf1(y.hf1, y.hf2), y.cf, y.zf);
+}
+
 void CPU::setStatePtrs(SaveState &state) {
 	mem_.setStatePtrs(state);
 }
@@ -106,6 +196,8 @@ void CPU::saveState(SaveState &state) {
 }
 
 void CPU::loadState(SaveState const &state) {
+	// the cycle count is not part of the state.
+	unsigned long const count = cycleCount();
 	mem_.loadState(state);
 
 	cycleCounter_ = state.cpu.cycleCounter;
@@ -123,12 +215,33 @@ void CPU::loadState(SaveState const &state) {
 	l = state.cpu.l & 0xFF;
 	opcode_ = state.cpu.opcode;
 	prefetched_ = state.cpu.prefetched;
+	setCycleCount(count);
 	if (state.cpu.skip) {
 		opcode_ = mem_.read(pc_, cycleCounter_);
 		prefetched_ = true;
 	}
 }
 
+void CPU::copyState(CPU const &cpu) {
+	mem_.copyState(cpu.mem_);
+	cycleCounter_ = cpu.cycleCounter_;
+	pc_ = cpu.pc_;
+	sp = cpu.sp;
+	hf1 = cpu.hf1;
+	hf2 = cpu.hf2;
+	zf = cpu.zf;
+	cf = cpu.cf;
+	a_ = cpu.a_;
+	b = cpu.b;
+	c = cpu.c;
+	d = cpu.d;
+	e = cpu.e;
+	h = cpu.h;
+	l = cpu.l;
+	opcode_ = cpu.opcode_;
+	prefetched_ = cpu.prefetched_;
+}
+
 // The main reasons for the use of macros is to more conveniently be able to tweak
 // which variables are local and which are not, combined with the fact that at the
 // time they were written GCC had a tendency to not be able to keep hot variables
@@ -139,7 +252,21 @@ void CPU::loadState(SaveState const &state) {
 #define hl() ( h * 0x100u | l )
 
 #define READ(dest, addr) do { (dest) = mem_.read(addr, cycleCounter); cycleCounter += 4; } while (0)
-#define PC_READ(dest) do { (dest) = mem_.read(pc, cycleCounter); pc = (pc + 1) & 0xFFFF; cycleCounter += 4; } while (0)
+// opimm points to the pre-decoded operands of the current instruction when it was taken
+// from the block cache.
+#define PC_READ(dest) do { \
+	(dest) = cached && opimm ? *opimm++ : mem_.read(pc, cycleCounter); \
+	pc = (pc + 1) & 0xFFFF; \
+	cycleCounter += 4; \
+} while (0)
+// opcode fetch. on a breakpoint, goes back around the instruction loop with pc and
+// cycleCounter untouched, which ends the run since Memory::fetch ends it at cycleCounter.
+// not a do-while, since the continue is for the enclosing loop.
+#define OPCODE_READ(dest) \
+	if (!mem_.fetch(pc, cycleCounter, dest)) \
+		continue; \
+	pc = (pc + 1) & 0xFFFF; \
+	cycleCounter += 4
 #define FF_READ(dest, addr) do { (dest) = mem_.ff_read(addr, cycleCounter); cycleCounter += 4; } while (0)
 
 #define WRITE(addr, data) do { mem_.write(addr, data, cycleCounter); cycleCounter += 4; } while (0)
@@ -496,6 +623,14 @@ void CPU::loadState(SaveState const &state) {
 
 namespace {
 
+struct IdleLoopHead {
+	unsigned long cc;
+	unsigned hf1, hf2, zf, cf;
+	unsigned short pc;
+	unsigned char a;
+	bool valid;
+};
+
 unsigned long freeze(Memory &mem, unsigned long cc) {
 	mem.freeze(cc);
 	if (cc < mem.nextEventTime()) {
@@ -508,12 +643,214 @@ unsigned long freeze(Memory &mem, unsigned long cc) {
 
 }
 
+// Opcode cases are written as OP(n)/CB_OP(n) and end in NEXT_OP. Normally these are
+// plain switch cases ending in break. Building with GAMBATTE_THREADED_DISPATCH
+// (GCC/Clang only) also labels each case and enters the switches through tables of
+// label addresses instead. NEXT_OP then fetches the next opcode and jumps straight
+// to its handler whenever the loop would simply go on to do the same (and there is
+// no backward branch to check for an idle loop), so that each handler ends in its
+// own indirect jump rather than all sharing the one of the switch. The cached path
+// still goes through the loop. The case bodies are the same in both builds.
+#if defined(GAMBATTE_THREADED_DISPATCH) && defined(__GNUC__)
+#define OP(n) case n: op_##n
+#define CB_OP(n) case n: cb_##n
+#define DISPATCH(table, opcode) goto *table[opcode]
+#define NEXT_OP \
+	if (!cached && !prefetched_ && cycleCounter < mem_.nextEventTime() && pc > oppc) { \
+		oppc = pc; \
+		OPCODE_READ(opcode); \
+		++ops; \
+		PROFILE_OP(opcode); \
+		TRACE_OP(opcode); \
+		DISPATCH(optable, opcode); \
+	} else break
+#define DISPATCH_ROW(p, h) \
+	&&p##h##0, &&p##h##1, &&p##h##2, &&p##h##3, &&p##h##4, &&p##h##5, &&p##h##6, &&p##h##7, \
+	&&p##h##8, &&p##h##9, &&p##h##A, &&p##h##B, &&p##h##C, &&p##h##D, &&p##h##E, &&p##h##F
+#else
+#define OP(n) case n
+#define CB_OP(n) case n
+#define DISPATCH(table, opcode) do {} while (0)
+#define NEXT_OP break
+#endif
+
+// Building with GAMBATTE_PROFILER feeds each instruction to profiler_ while it is
+// enabled. Otherwise these compile to nothing.
+#ifdef GAMBATTE_PROFILER
+#define PROFILE_OP(opcode) do { \
+	if (profiler_.enabled()) \
+		profiler_.op(oppc < mm_vram_begin ? mem_.romBank(oppc) : 0, oppc, opcode, cycleCounter - 4); \
+} while (0)
+#define PROFILE_CB_OP(opcode) do { \
+	if (profiler_.enabled()) \
+		profiler_.cbOp(opcode); \
+} while (0)
+#define PROFILE_EVENT() do { \
+	if (profiler_.enabled()) \
+		profiler_.charge(cycleCounter); \
+} while (0)
+#else
+#define PROFILE_OP(opcode) do {} while (0)
+#define PROFILE_CB_OP(opcode) do {} while (0)
+#define PROFILE_EVENT() do {} while (0)
+#endif
+
+// Likewise, building with GAMBATTE_TRACE records each instruction in trace_ while
+// it has a size.
+#ifdef GAMBATTE_TRACE
+#define TRACE_OP(opcode) do { \
+	if (trace_.enabled()) { \
+		trace_.record(cycleCounter - 4, oppc < mm_vram_begin ? mem_.romBank(oppc) : unsigned(trace_no_bank), \
+			oppc, sp, opcode, a, toF(updateHf2FromHf1(hf1, hf2), cf, zf), b, c, d, e, h, l); \
+	} \
+} while (0)
+#else
+#define TRACE_OP(opcode) do {} while (0)
+#endif
+
+// Checks that the loop from begin to the branch at end back to begin is free of side
+// effects and only changes a and F, reading nothing but WRAM, HRAM and LY. WRAM and
+// HRAM cannot change without the CPU writing to them or an event happening. Returns
+// the time up to which the loop is sure to keep doing what it has been doing since
+// 'since', or cc if it is not an idle loop.
+unsigned long CPU::idleLoopEnd(unsigned const begin, unsigned const end,
+		unsigned long const since, unsigned long const cc) {
+	unsigned char const *const code = mem_.rmem(begin >> 12);
+	// the closing branch and its operands must be in the same area too.
+	if (!code || end - begin > max_idle_loop_size || (begin ^ (end + 2)) >> 12)
+		return cc;
+
+	unsigned long limit = mem_.nextEventTime();
+
+	unsigned pc = begin;
+	while (pc < end) {
+		unsigned const opcode = code[pc];
+		unsigned addr = 0x10000;
+		unsigned size = 1;
+
+		switch (opcode) {
+		case 0x00: case 0x07: case 0x0F: case 0x17: case 0x1F:
+		case 0x2F: case 0x37: case 0x3C: case 0x3D: case 0x3F:
+		case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D: case 0x7F:
+			break;
+		case 0x0A: addr = bc(); break;
+		case 0x1A: addr = de(); break;
+		case 0xF2: addr = 0xFF00 | c; break;
+		case 0xC6: case 0xCE: case 0xD6: case 0xDE:
+		case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+			size = 2;
+			break;
+		case 0xF0:
+			addr = 0xFF00 | code[pc + 1];
+			size = 2;
+			break;
+		case 0xFA:
+			addr = code[pc + 2] << 8 | code[pc + 1];
+			size = 3;
+			break;
+		case 0xCB:
+			{
+				unsigned const cbop = code[pc + 1];
+				// bit n,r and the rotates/shifts of a.
+				if (cbop < 0x40 ? (cbop & 7) != 7 : cbop >= 0x80)
+					return cc;
+
+				if ((cbop & 7) == 6)
+					addr = hl();
+
+				size = 2;
+			}
+
+			break;
+		default:
+			if (opcode == 0x7E || (opcode >= 0x80 && opcode < 0xC0 && (opcode & 7) == 6))
+				addr = hl();
+			else if (opcode < 0x80 || opcode >= 0xC0)
+				return cc;
+
+			break;
+		}
+
+		if (addr == 0xFF44) {
+			unsigned long const lyEnd = mem_.lyStableUntil(since, cc);
+			if (lyEnd < limit)
+				limit = lyEnd;
+		} else if (addr < 0x10000) {
+			bool const wram = addr - mm_wram_begin < mm_wram_mirror_begin - mm_wram_begin
+			               && mem_.rmem(addr >> 12);
+			bool const hram = addr >= mm_hram_begin;
+			if (!wram && !hram)
+				return cc;
+		}
+
+		if ((pc += size) > end)
+			return cc;
+	}
+
+	unsigned const opcode = code[end];
+	unsigned target = 0x10000;
+	switch (opcode) {
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+		target = (end + 2 + ((code[end + 1] ^ 0x80) - 0x80)) & 0xFFFF;
+		break;
+	case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:
+		target = code[end + 2] << 8 | code[end + 1];
+		break;
+	}
+
+	return target == begin ? limit : cc;
+}
+
+bool CPU::isIdleLoopHint(unsigned const pc) const {
+	long const offset = mem_.romOffset(pc);
+	return offset >= 0
+	    && std::binary_search(idleLoopHints_.begin(), idleLoopHints_.end(),
+	                          static_cast<unsigned long>(offset));
+}
+
+template <bool cached>
 void CPU::process(unsigned long const cycles) {
+#if defined(GAMBATTE_THREADED_DISPATCH) && defined(__GNUC__)
+	static void *const optable[0x100] = {
+		DISPATCH_ROW(op_, 0x0), DISPATCH_ROW(op_, 0x1), DISPATCH_ROW(op_, 0x2), DISPATCH_ROW(op_, 0x3),
+		DISPATCH_ROW(op_, 0x4), DISPATCH_ROW(op_, 0x5), DISPATCH_ROW(op_, 0x6), DISPATCH_ROW(op_, 0x7),
+		DISPATCH_ROW(op_, 0x8), DISPATCH_ROW(op_, 0x9), DISPATCH_ROW(op_, 0xA), DISPATCH_ROW(op_, 0xB),
+		DISPATCH_ROW(op_, 0xC),
+		// 0xDD has no case and does nothing, same as nop.
+		&&op_0xD0, &&op_0xD1, &&op_0xD2, &&op_0xD3, &&op_0xD4, &&op_0xD5, &&op_0xD6, &&op_0xD7,
+		&&op_0xD8, &&op_0xD9, &&op_0xDA, &&op_0xDB, &&op_0xDC, &&op_0x00, &&op_0xDE, &&op_0xDF,
+		DISPATCH_ROW(op_, 0xE), DISPATCH_ROW(op_, 0xF)
+	};
+	static void *const cbtable[0x100] = {
+		DISPATCH_ROW(cb_, 0x0), DISPATCH_ROW(cb_, 0x1), DISPATCH_ROW(cb_, 0x2), DISPATCH_ROW(cb_, 0x3),
+		DISPATCH_ROW(cb_, 0x4), DISPATCH_ROW(cb_, 0x5), DISPATCH_ROW(cb_, 0x6), DISPATCH_ROW(cb_, 0x7),
+		DISPATCH_ROW(cb_, 0x8), DISPATCH_ROW(cb_, 0x9), DISPATCH_ROW(cb_, 0xA), DISPATCH_ROW(cb_, 0xB),
+		DISPATCH_ROW(cb_, 0xC), DISPATCH_ROW(cb_, 0xD), DISPATCH_ROW(cb_, 0xE), DISPATCH_ROW(cb_, 0xF)
+	};
+#endif
+
 	mem_.setEndtime(cycleCounter_, cycles);
 	mem_.updateInput();
 
 	unsigned char a = a_;
 	unsigned long cycleCounter = cycleCounter_;
+	// remaining ops of the cached block currently being executed, and the area
+	// mapping they were decoded from.
+	DecodedOp const *op = 0, *opEnd = 0;
+	unsigned char const *oppage = 0;
+	// pending comparison of a native block run against the interpreter, for
+	// Jit::mode_verify. Checked once op reaches verifyEnd.
+	BlockCache::Block *verifyBlock = 0;
+	DecodedOp const *verifyEnd = 0;
+	JitRegs verifyRegs = JitRegs();
+	unsigned long verifyCycles = 0;
+	unsigned short verifyPc = 0;
+	// pc of the instruction being executed, and the state seen at the target of
+	// the last backward branch, for detecting idle loops.
+	unsigned short oppc = 0;
+	IdleLoopHead idle = IdleLoopHead();
+	// instructions executed, added to instructions_ at the end.
+	unsigned long ops = 0;
 
 	while (mem_.isActive()) {
 		unsigned short pc = pc_;
@@ -525,49 +862,109 @@ void CPU::process(unsigned long const cycles) {
 			}
 		} else while (cycleCounter < mem_.nextEventTime()) {
 			unsigned char opcode;
+			unsigned char const *opimm = 0;
+			bool fuse = false;
+
+			oppc = pc;
+			if (cached && !prefetched_) {
+				if (op == opEnd || op->pc != pc || mem_.rmem(pc >> 12) != oppage) {
+					op = opEnd = verifyEnd = 0;
+					if ((oppage = mem_.rmem(pc >> 12)) != 0) {
+						BlockCache::Block &block = blockCache_.find(oppage, pc);
+						op = block.ops;
+						opEnd = op + block.numOps;
+
+						if (jit_.mode() != Jit::mode_off && BlockCache::isRom(pc)) {
+							if (block.hits < Jit::hot_threshold && ++block.hits == Jit::hot_threshold
+									&& !jit_.compile(block)) {
+								blockCache_.invalidate();
+								jit_.flush();
+							}
+
+							// native code does not check for events, so it only runs when
+							// all of its instructions start before the next one.
+							if (block.native && cycleCounter + block.nativeLead < mem_.nextEventTime()) {
+								JitRegs regs;
+								getJitRegs(regs, a);
+								unsigned long const res = Jit::run(block, regs);
+
+								if (jit_.mode() == Jit::mode_on) {
+									a = setJitRegs(regs);
+									pc = res & 0xFFFF;
+									cycleCounter += res >> 16;
+									op = block.ops + block.nativeOps;
+									ops += block.nativeOps;
+									continue;
+								}
+
+								verifyBlock = &block;
+								verifyEnd = block.ops + block.nativeOps;
+								verifyRegs = regs;
+								verifyPc = res & 0xFFFF;
+								verifyCycles = cycleCounter + (res >> 16);
+							}
+						}
+					}
+				}
 
-			if (!prefetched_) {
-				PC_READ(opcode);
+				if (op != opEnd && (BlockCache::isRom(pc) || BlockCache::matches(*op, oppage))) {
+					opcode = op->opcode;
+					opimm = op->imm;
+					fuse = op->fuse;
+					pc = (pc + 1) & 0xFFFF;
+					cycleCounter += 4;
+					++op;
+				} else {
+					op = opEnd;
+					OPCODE_READ(opcode);
+				}
+			} else if (!prefetched_) {
+				OPCODE_READ(opcode);
 			} else {
 				opcode = opcode_;
 				cycleCounter += 4;
 				prefetched_ = false;
+				idle.valid = false;
 			}
 
+			++ops;
+			PROFILE_OP(opcode);
+			TRACE_OP(opcode);
+			DISPATCH(optable, opcode);
 			switch (opcode) {
-			case 0x00:
-				break;
-			case 0x01:
+			OP(0x00):
+				NEXT_OP;
+			OP(0x01):
 				ld_rr_nn(b, c);
-				break;
-			case 0x02:
+				NEXT_OP;
+			OP(0x02):
 				WRITE(bc(), a);
-				break;
-			case 0x03:
+				NEXT_OP;
+			OP(0x03):
 				inc_rr(b, c);
-				break;
-			case 0x04:
+				NEXT_OP;
+			OP(0x04):
 				inc_r(b);
-				break;
-			case 0x05:
+				NEXT_OP;
+			OP(0x05):
 				dec_r(b); 
-				break;
-			case 0x06:
+				NEXT_OP;
+			OP(0x06):
 				PC_READ(b);
-				break;
+				NEXT_OP;
 
 				// rlca (4 cycles):
 				// Rotate 8-bit register A left, store old bit7 in CF. Reset SF, HCF, ZF:
-			case 0x07:
+			OP(0x07):
 				cf = a << 1;
 				a = (cf | cf >> 8) & 0xFF;
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OP;
 
 				// ld (nn),SP (20 cycles):
 				// Put value of SP into address given by next 2 bytes in memory:
-			case 0x08:
+			OP(0x08):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -578,39 +975,39 @@ void CPU::process(unsigned long const cycles) {
 					WRITE((addr + 1) & 0xFFFF, sp >> 8);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x09:
+			OP(0x09):
 				add_hl_rr(b, c);
-				break;
-			case 0x0A:
+				NEXT_OP;
+			OP(0x0A):
 				READ(a, bc());
-				break;
-			case 0x0B:
+				NEXT_OP;
+			OP(0x0B):
 				dec_rr(b, c);
-				break;
-			case 0x0C:
+				NEXT_OP;
+			OP(0x0C):
 				inc_r(c);
-				break;
-			case 0x0D:
+				NEXT_OP;
+			OP(0x0D):
 				dec_r(c);
-				break;
-			case 0x0E:
+				NEXT_OP;
+			OP(0x0E):
 				PC_READ(c);
-				break;
+				NEXT_OP;
 
 				// rrca (4 cycles):
 				// Rotate 8-bit register A right, store old bit0 in CF. Reset SF, HCF, ZF:
-			case 0x0F:
+			OP(0x0F):
 				cf = a * 0x100u | a;
 				a = cf >> 1 & 0xFF;
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OP;
 
 				// stop (4 cycles):
 				// Halt CPU and LCD display until button pressed:
-			case 0x10:
+			OP(0x10):
 				PC_READ(opcode_);
 				cycleCounter = mem_.stop(cycleCounter - 4, prefetched_);
 				if (cycleCounter < mem_.nextEventTime()) {
@@ -618,31 +1015,31 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += cpu_cycles + (-cpu_cycles & 3);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x11:
+			OP(0x11):
 				ld_rr_nn(d, e);
-				break;
-			case 0x12:
+				NEXT_OP;
+			OP(0x12):
 				WRITE(de(), a);
-				break;
-			case 0x13:
+				NEXT_OP;
+			OP(0x13):
 				inc_rr(d, e);
-				break;
-			case 0x14:
+				NEXT_OP;
+			OP(0x14):
 				inc_r(d);
-				break;
-			case 0x15:
+				NEXT_OP;
+			OP(0x15):
 				dec_r(d);
-				break;
-			case 0x16:
+				NEXT_OP;
+			OP(0x16):
 				PC_READ(d);
-				break;
+				NEXT_OP;
 
 				// rla (4 cycles):
 				// Rotate 8-bit register A left through CF, store old bit7 in CF,
 				// old CF value becomes bit0. Reset SF, HCF, ZF:
-			case 0x17:
+			OP(0x17):
 				{
 					unsigned oldcf = cf >> 8 & 1;
 					cf = a << 1;
@@ -651,34 +1048,34 @@ void CPU::process(unsigned long const cycles) {
 
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OP;
 
-			case 0x18:
+			OP(0x18):
 				jr_disp();
-				break;
-			case 0x19:
+				NEXT_OP;
+			OP(0x19):
 				add_hl_rr(d, e);
-				break;
-			case 0x1A:
+				NEXT_OP;
+			OP(0x1A):
 				READ(a, de());
-				break;
-			case 0x1B:
+				NEXT_OP;
+			OP(0x1B):
 				dec_rr(d, e);
-				break;
-			case 0x1C:
+				NEXT_OP;
+			OP(0x1C):
 				inc_r(e);
-				break;
-			case 0x1D:
+				NEXT_OP;
+			OP(0x1D):
 				dec_r(e);
-				break;
-			case 0x1E:
+				NEXT_OP;
+			OP(0x1E):
 				PC_READ(e);
-				break;
+				NEXT_OP;
 
 				// rra (4 cycles):
 				// Rotate 8-bit register A right through CF, store old bit0 in CF,
 				// old CF value becomes bit7. Reset SF, HCF, ZF:
-			case 0x1F:
+			OP(0x1F):
 				{
 					unsigned oldcf = cf & 0x100;
 					cf = a * 0x100u;
@@ -687,24 +1084,24 @@ void CPU::process(unsigned long const cycles) {
 
 				hf2 = 0;
 				zf = 1;
-				break;
+				NEXT_OP;
 
 				// jr nz,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if ZF is unset:
-			case 0x20:
+			OP(0x20):
 				if (zf & 0xFF) {
 					jr_disp();
 				} else {
 					PC_MOD((pc + 1) & 0xFFFF);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x21: ld_rr_nn(h, l); break;
+			OP(0x21): ld_rr_nn(h, l); NEXT_OP;
 
 				// ldi (hl),a (8 cycles):
 				// Put A into memory address in hl. Increment HL:
-			case 0x22:
+			OP(0x22):
 				{
 					unsigned addr = hl();
 					WRITE(addr, a);
@@ -714,24 +1111,24 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x23:
+			OP(0x23):
 				inc_rr(h, l);
-				break;
-			case 0x24:
+				NEXT_OP;
+			OP(0x24):
 				inc_r(h);
-				break;
-			case 0x25:
+				NEXT_OP;
+			OP(0x25):
 				dec_r(h);
-				break;
-			case 0x26:
+				NEXT_OP;
+			OP(0x26):
 				PC_READ(h);
-				break;
+				NEXT_OP;
 
 				// daa (4 cycles):
 				// Adjust register A to correctly represent a BCD. Check ZF, HF and CF:
-			case 0x27:
+			OP(0x27):
 				hf2 = updateHf2FromHf1(hf1, hf2);
 
 				{
@@ -755,26 +1152,26 @@ void CPU::process(unsigned long const cycles) {
 					a &= 0xFF;
 				}
 
-				break;
+				NEXT_OP;
 
 				// jr z,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if ZF is set:
-			case 0x28:
+			OP(0x28):
 				if (zf & 0xFF) {
 					PC_MOD((pc + 1) & 0xFFFF);
 				} else {
 					jr_disp();
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x29:
+			OP(0x29):
 				add_hl_rr(h, l);
-				break;
+				NEXT_OP;
 
 				// ldi a,(hl) (8 cycles):
 				// Put value at address in hl into A. Increment HL:
-			case 0x2A:
+			OP(0x2A):
 				{
 					unsigned addr = hl();
 					READ(a, addr);
@@ -784,42 +1181,42 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x2B:
+			OP(0x2B):
 				dec_rr(h, l);
-				break;
-			case 0x2C:
+				NEXT_OP;
+			OP(0x2C):
 				inc_r(l);
-				break;
-			case 0x2D:
+				NEXT_OP;
+			OP(0x2D):
 				dec_r(l);
-				break;
-			case 0x2E:
+				NEXT_OP;
+			OP(0x2E):
 				PC_READ(l);
-				break;
+				NEXT_OP;
 
 				// cpl (4 cycles):
 				// Complement register A. (Flip all bits), set SF and HCF:
-			case 0x2F:
+			OP(0x2F):
 				hf2 = hf2_subf | hf2_hcf;
 				a ^= 0xFF;
-				break;
+				NEXT_OP;
 
 				// jr nc,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if CF is unset:
-			case 0x30:
+			OP(0x30):
 				if (cf & 0x100) {
 					PC_MOD((pc + 1) & 0xFFFF);
 				} else {
 					jr_disp();
 				}
 
-				break;
+				NEXT_OP;
 
 				// ld sp,nn (12 cycles)
 				// set sp to 16-bit value of next 2 bytes in memory
-			case 0x31:
+			OP(0x31):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -828,11 +1225,11 @@ void CPU::process(unsigned long const cycles) {
 					sp = immh << 8 | imml;
 				}
 
-				break;
+				NEXT_OP;
 
 				// ldd (hl),a (8 cycles):
 				// Put A into memory address in hl. Decrement HL:
-			case 0x32:
+			OP(0x32):
 				{
 					unsigned addr = hl();
 					WRITE(addr, a);
@@ -842,16 +1239,16 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x33:
+			OP(0x33):
 				sp = (sp + 1) & 0xFFFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OP;
 
 				// inc (hl) (12 cycles):
 				// Increment value at address in hl, check flags except CF:
-			case 0x34:
+			OP(0x34):
 				{
 					unsigned const addr = hl();
 					READ(hf2, addr);
@@ -860,11 +1257,11 @@ void CPU::process(unsigned long const cycles) {
 					hf2 |= hf2_incf;
 				}
 
-				break;
+				NEXT_OP;
 
 				// dec (hl) (12 cycles):
 				// Decrement value at address in hl, check flags except CF:
-			case 0x35:
+			OP(0x35):
 				{
 					unsigned const addr = hl();
 					READ(hf2, addr);
@@ -873,40 +1270,40 @@ void CPU::process(unsigned long const cycles) {
 					hf2 |= hf2_incf | hf2_subf;
 				}
 
-				break;
+				NEXT_OP;
 
 				// ld (hl),n (12 cycles):
 				// set memory at address in hl to value of next byte in memory:
-			case 0x36:
+			OP(0x36):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					WRITE(hl(), imm);
 				}
 
-				break;
+				NEXT_OP;
 
 				// scf (4 cycles):
 				// Set CF. Unset SF and HCF:
-			case 0x37:
+			OP(0x37):
 				cf = 0x100;
 				hf2 = 0;
-				break;
+				NEXT_OP;
 
 				// jr c,disp (12;8 cycles):
 				// Jump to value of next (signed) byte in memory+current address if CF is set:
-			case 0x38:
+			OP(0x38):
 				if (cf & 0x100) {
 					jr_disp();
 				} else {
 					PC_MOD((pc + 1) & 0xFFFF);
 				}
 
-				break;
+				NEXT_OP;
 
 				// add hl,sp (8 cycles):
 				// add SP to HL, check flags except ZF:
-			case 0x39:
+			OP(0x39):
 				cf = l + sp;
 				l = cf & 0xFF;
 				hf1 = h;
@@ -915,11 +1312,11 @@ void CPU::process(unsigned long const cycles) {
 				cf += h;
 				h = cf & 0xFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OP;
 
 				// ldd a,(hl) (8 cycles):
 				// Put value at address in hl into A. Decrement HL:
-			case 0x3A:
+			OP(0x3A):
 				{
 					unsigned addr = hl();
 					a = mem_.read(addr, cycleCounter);
@@ -930,93 +1327,93 @@ void CPU::process(unsigned long const cycles) {
 					h = addr >> 8;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0x3B:
+			OP(0x3B):
 				sp = (sp - 1) & 0xFFFF;
 				cycleCounter += 4;
-				break;
+				NEXT_OP;
 
-			case 0x3C:
+			OP(0x3C):
 				inc_r(a);
-				break;
-			case 0x3D:
+				NEXT_OP;
+			OP(0x3D):
 				dec_r(a);
-				break;
-			case 0x3E:
+				NEXT_OP;
+			OP(0x3E):
 				PC_READ(a);
-				break;
+				NEXT_OP;
 
 				// ccf (4 cycles):
 				// Complement CF (unset if set vv.) Unset SF and HCF.
-			case 0x3F:
+			OP(0x3F):
 				cf ^= 0x100;
 				hf2 = 0;
-				break;
-
-			case 0x40: /*b = b;*/ break;
-			case 0x41: b = c; break;
-			case 0x42: b = d; break;
-			case 0x43: b = e; break;
-			case 0x44: b = h; break;
-			case 0x45: b = l; break;
-			case 0x46: READ(b, hl()); break;
-			case 0x47: b = a; break;
-
-			case 0x48: c = b; break;
-			case 0x49: /*c = c;*/ break;
-			case 0x4A: c = d; break;
-			case 0x4B: c = e; break;
-			case 0x4C: c = h; break;
-			case 0x4D: c = l; break;
-			case 0x4E: READ(c, hl()); break;
-			case 0x4F: c = a; break;
-
-			case 0x50: d = b; break;
-			case 0x51: d = c; break;
-			case 0x52: /*d = d;*/ break;
-			case 0x53: d = e; break;
-			case 0x54: d = h; break;
-			case 0x55: d = l; break;
-			case 0x56: READ(d, hl()); break;
-			case 0x57: d = a; break;
-
-			case 0x58: e = b; break;
-			case 0x59: e = c; break;
-			case 0x5A: e = d; break;
-			case 0x5B: /*e = e;*/ break;
-			case 0x5C: e = h; break;
-			case 0x5D: e = l; break;
-			case 0x5E: READ(e, hl()); break;
-			case 0x5F: e = a; break;
-
-			case 0x60: h = b; break;
-			case 0x61: h = c; break;
-			case 0x62: h = d; break;
-			case 0x63: h = e; break;
-			case 0x64: /*h = h;*/ break;
-			case 0x65: h = l; break;
-			case 0x66: READ(h, hl()); break;
-			case 0x67: h = a; break;
-
-			case 0x68: l = b; break;
-			case 0x69: l = c; break;
-			case 0x6A: l = d; break;
-			case 0x6B: l = e; break;
-			case 0x6C: l = h; break;
-			case 0x6D: /*l = l;*/ break;
-			case 0x6E: READ(l, hl()); break;
-			case 0x6F: l = a; break;
-
-			case 0x70: WRITE(hl(), b); break;
-			case 0x71: WRITE(hl(), c); break;
-			case 0x72: WRITE(hl(), d); break;
-			case 0x73: WRITE(hl(), e); break;
-			case 0x74: WRITE(hl(), h); break;
-			case 0x75: WRITE(hl(), l); break;
+				NEXT_OP;
+
+			OP(0x40): /*b = b;*/ NEXT_OP;
+			OP(0x41): b = c; NEXT_OP;
+			OP(0x42): b = d; NEXT_OP;
+			OP(0x43): b = e; NEXT_OP;
+			OP(0x44): b = h; NEXT_OP;
+			OP(0x45): b = l; NEXT_OP;
+			OP(0x46): READ(b, hl()); NEXT_OP;
+			OP(0x47): b = a; NEXT_OP;
+
+			OP(0x48): c = b; NEXT_OP;
+			OP(0x49): /*c = c;*/ NEXT_OP;
+			OP(0x4A): c = d; NEXT_OP;
+			OP(0x4B): c = e; NEXT_OP;
+			OP(0x4C): c = h; NEXT_OP;
+			OP(0x4D): c = l; NEXT_OP;
+			OP(0x4E): READ(c, hl()); NEXT_OP;
+			OP(0x4F): c = a; NEXT_OP;
+
+			OP(0x50): d = b; NEXT_OP;
+			OP(0x51): d = c; NEXT_OP;
+			OP(0x52): /*d = d;*/ NEXT_OP;
+			OP(0x53): d = e; NEXT_OP;
+			OP(0x54): d = h; NEXT_OP;
+			OP(0x55): d = l; NEXT_OP;
+			OP(0x56): READ(d, hl()); NEXT_OP;
+			OP(0x57): d = a; NEXT_OP;
+
+			OP(0x58): e = b; NEXT_OP;
+			OP(0x59): e = c; NEXT_OP;
+			OP(0x5A): e = d; NEXT_OP;
+			OP(0x5B): /*e = e;*/ NEXT_OP;
+			OP(0x5C): e = h; NEXT_OP;
+			OP(0x5D): e = l; NEXT_OP;
+			OP(0x5E): READ(e, hl()); NEXT_OP;
+			OP(0x5F): e = a; NEXT_OP;
+
+			OP(0x60): h = b; NEXT_OP;
+			OP(0x61): h = c; NEXT_OP;
+			OP(0x62): h = d; NEXT_OP;
+			OP(0x63): h = e; NEXT_OP;
+			OP(0x64): /*h = h;*/ NEXT_OP;
+			OP(0x65): h = l; NEXT_OP;
+			OP(0x66): READ(h, hl()); NEXT_OP;
+			OP(0x67): h = a; NEXT_OP;
+
+			OP(0x68): l = b; NEXT_OP;
+			OP(0x69): l = c; NEXT_OP;
+			OP(0x6A): l = d; NEXT_OP;
+			OP(0x6B): l = e; NEXT_OP;
+			OP(0x6C): l = h; NEXT_OP;
+			OP(0x6D): /*l = l;*/ NEXT_OP;
+			OP(0x6E): READ(l, hl()); NEXT_OP;
+			OP(0x6F): l = a; NEXT_OP;
+
+			OP(0x70): WRITE(hl(), b); NEXT_OP;
+			OP(0x71): WRITE(hl(), c); NEXT_OP;
+			OP(0x72): WRITE(hl(), d); NEXT_OP;
+			OP(0x73): WRITE(hl(), e); NEXT_OP;
+			OP(0x74): WRITE(hl(), h); NEXT_OP;
+			OP(0x75): WRITE(hl(), l); NEXT_OP;
 
 				// halt (4n cycles):
-			case 0x76:
+			OP(0x76):
 				opcode_ = mem_.read(pc, cycleCounter);
 				if (mem_.pendingIrqs(cycleCounter)) {
 					prefetched_ = true;
@@ -1029,130 +1426,130 @@ void CPU::process(unsigned long const cycles) {
 					}
 				}
 
-				break;
-
-			case 0x77: WRITE(hl(), a); break;
-			case 0x78: a = b; break;
-			case 0x79: a = c; break;
-			case 0x7A: a = d; break;
-			case 0x7B: a = e; break;
-			case 0x7C: a = h; break;
-			case 0x7D: a = l; break;
-			case 0x7E: READ(a, hl()); break;
-			case 0x7F: /*a = a;*/ break;
-
-			case 0x80: add_a_u8(b); break;
-			case 0x81: add_a_u8(c); break;
-			case 0x82: add_a_u8(d); break;
-			case 0x83: add_a_u8(e); break;
-			case 0x84: add_a_u8(h); break;
-			case 0x85: add_a_u8(l); break;
-			case 0x86: { unsigned data; READ(data, hl()); add_a_u8(data); } break;
-			case 0x87: add_a_u8(a); break;
-
-			case 0x88: adc_a_u8(b); break;
-			case 0x89: adc_a_u8(c); break;
-			case 0x8A: adc_a_u8(d); break;
-			case 0x8B: adc_a_u8(e); break;
-			case 0x8C: adc_a_u8(h); break;
-			case 0x8D: adc_a_u8(l); break;
-			case 0x8E: { unsigned data; READ(data, hl()); adc_a_u8(data); } break;
-			case 0x8F: adc_a_u8(a); break;
-
-			case 0x90: sub_a_u8(b); break;
-			case 0x91: sub_a_u8(c); break;
-			case 0x92: sub_a_u8(d); break;
-			case 0x93: sub_a_u8(e); break;
-			case 0x94: sub_a_u8(h); break;
-			case 0x95: sub_a_u8(l); break;
-			case 0x96: { unsigned data; READ(data, hl()); sub_a_u8(data); } break;
+				NEXT_OP;
+
+			OP(0x77): WRITE(hl(), a); NEXT_OP;
+			OP(0x78): a = b; NEXT_OP;
+			OP(0x79): a = c; NEXT_OP;
+			OP(0x7A): a = d; NEXT_OP;
+			OP(0x7B): a = e; NEXT_OP;
+			OP(0x7C): a = h; NEXT_OP;
+			OP(0x7D): a = l; NEXT_OP;
+			OP(0x7E): READ(a, hl()); NEXT_OP;
+			OP(0x7F): /*a = a;*/ NEXT_OP;
+
+			OP(0x80): add_a_u8(b); NEXT_OP;
+			OP(0x81): add_a_u8(c); NEXT_OP;
+			OP(0x82): add_a_u8(d); NEXT_OP;
+			OP(0x83): add_a_u8(e); NEXT_OP;
+			OP(0x84): add_a_u8(h); NEXT_OP;
+			OP(0x85): add_a_u8(l); NEXT_OP;
+			OP(0x86): { unsigned data; READ(data, hl()); add_a_u8(data); } NEXT_OP;
+			OP(0x87): add_a_u8(a); NEXT_OP;
+
+			OP(0x88): adc_a_u8(b); NEXT_OP;
+			OP(0x89): adc_a_u8(c); NEXT_OP;
+			OP(0x8A): adc_a_u8(d); NEXT_OP;
+			OP(0x8B): adc_a_u8(e); NEXT_OP;
+			OP(0x8C): adc_a_u8(h); NEXT_OP;
+			OP(0x8D): adc_a_u8(l); NEXT_OP;
+			OP(0x8E): { unsigned data; READ(data, hl()); adc_a_u8(data); } NEXT_OP;
+			OP(0x8F): adc_a_u8(a); NEXT_OP;
+
+			OP(0x90): sub_a_u8(b); NEXT_OP;
+			OP(0x91): sub_a_u8(c); NEXT_OP;
+			OP(0x92): sub_a_u8(d); NEXT_OP;
+			OP(0x93): sub_a_u8(e); NEXT_OP;
+			OP(0x94): sub_a_u8(h); NEXT_OP;
+			OP(0x95): sub_a_u8(l); NEXT_OP;
+			OP(0x96): { unsigned data; READ(data, hl()); sub_a_u8(data); } NEXT_OP;
 
 				// A-A is always 0:
-			case 0x97:
+			OP(0x97):
 				hf2 = hf2_subf;
 				cf = zf = a = 0;
-				break;
-
-			case 0x98: sbc_a_u8(b); break;
-			case 0x99: sbc_a_u8(c); break;
-			case 0x9A: sbc_a_u8(d); break;
-			case 0x9B: sbc_a_u8(e); break;
-			case 0x9C: sbc_a_u8(h); break;
-			case 0x9D: sbc_a_u8(l); break;
-			case 0x9E: { unsigned data; READ(data, hl()); sbc_a_u8(data); } break;
-			case 0x9F: sbc_a_u8(a); break;
-
-			case 0xA0: and_a_u8(b); break;
-			case 0xA1: and_a_u8(c); break;
-			case 0xA2: and_a_u8(d); break;
-			case 0xA3: and_a_u8(e); break;
-			case 0xA4: and_a_u8(h); break;
-			case 0xA5: and_a_u8(l); break;
-			case 0xA6: { unsigned data; READ(data, hl()); and_a_u8(data); } break;
+				NEXT_OP;
+
+			OP(0x98): sbc_a_u8(b); NEXT_OP;
+			OP(0x99): sbc_a_u8(c); NEXT_OP;
+			OP(0x9A): sbc_a_u8(d); NEXT_OP;
+			OP(0x9B): sbc_a_u8(e); NEXT_OP;
+			OP(0x9C): sbc_a_u8(h); NEXT_OP;
+			OP(0x9D): sbc_a_u8(l); NEXT_OP;
+			OP(0x9E): { unsigned data; READ(data, hl()); sbc_a_u8(data); } NEXT_OP;
+			OP(0x9F): sbc_a_u8(a); NEXT_OP;
+
+			OP(0xA0): and_a_u8(b); NEXT_OP;
+			OP(0xA1): and_a_u8(c); NEXT_OP;
+			OP(0xA2): and_a_u8(d); NEXT_OP;
+			OP(0xA3): and_a_u8(e); NEXT_OP;
+			OP(0xA4): and_a_u8(h); NEXT_OP;
+			OP(0xA5): and_a_u8(l); NEXT_OP;
+			OP(0xA6): { unsigned data; READ(data, hl()); and_a_u8(data); } NEXT_OP;
 
 				// A&A will always be A:
-			case 0xA7:
+			OP(0xA7):
 				zf = a;
 				cf = 0;
 				hf2 = hf2_hcf;
-				break;
+				NEXT_OP;
 
-			case 0xA8: xor_a_u8(b); break;
-			case 0xA9: xor_a_u8(c); break;
-			case 0xAA: xor_a_u8(d); break;
-			case 0xAB: xor_a_u8(e); break;
-			case 0xAC: xor_a_u8(h); break;
-			case 0xAD: xor_a_u8(l); break;
-			case 0xAE: { unsigned data; READ(data, hl()); xor_a_u8(data); } break;
+			OP(0xA8): xor_a_u8(b); NEXT_OP;
+			OP(0xA9): xor_a_u8(c); NEXT_OP;
+			OP(0xAA): xor_a_u8(d); NEXT_OP;
+			OP(0xAB): xor_a_u8(e); NEXT_OP;
+			OP(0xAC): xor_a_u8(h); NEXT_OP;
+			OP(0xAD): xor_a_u8(l); NEXT_OP;
+			OP(0xAE): { unsigned data; READ(data, hl()); xor_a_u8(data); } NEXT_OP;
 
 				// A^A will always be 0:
-			case 0xAF: cf = hf2 = zf = a = 0; break;
+			OP(0xAF): cf = hf2 = zf = a = 0; NEXT_OP;
 
-			case 0xB0: or_a_u8(b); break;
-			case 0xB1: or_a_u8(c); break;
-			case 0xB2: or_a_u8(d); break;
-			case 0xB3: or_a_u8(e); break;
-			case 0xB4: or_a_u8(h); break;
-			case 0xB5: or_a_u8(l); break;
-			case 0xB6: { unsigned data; READ(data, hl()); or_a_u8(data); } break;
+			OP(0xB0): or_a_u8(b); NEXT_OP;
+			OP(0xB1): or_a_u8(c); NEXT_OP;
+			OP(0xB2): or_a_u8(d); NEXT_OP;
+			OP(0xB3): or_a_u8(e); NEXT_OP;
+			OP(0xB4): or_a_u8(h); NEXT_OP;
+			OP(0xB5): or_a_u8(l); NEXT_OP;
+			OP(0xB6): { unsigned data; READ(data, hl()); or_a_u8(data); } NEXT_OP;
 
 				// A|A will always be A:
-			case 0xB7:
+			OP(0xB7):
 				zf = a;
 				hf2 = cf = 0;
-				break;
+				NEXT_OP;
 
-			case 0xB8: cp_a_u8(b); break;
-			case 0xB9: cp_a_u8(c); break;
-			case 0xBA: cp_a_u8(d); break;
-			case 0xBB: cp_a_u8(e); break;
-			case 0xBC: cp_a_u8(h); break;
-			case 0xBD: cp_a_u8(l); break;
-			case 0xBE: { unsigned data; READ(data, hl()); cp_a_u8(data); } break;
+			OP(0xB8): cp_a_u8(b); NEXT_OP;
+			OP(0xB9): cp_a_u8(c); NEXT_OP;
+			OP(0xBA): cp_a_u8(d); NEXT_OP;
+			OP(0xBB): cp_a_u8(e); NEXT_OP;
+			OP(0xBC): cp_a_u8(h); NEXT_OP;
+			OP(0xBD): cp_a_u8(l); NEXT_OP;
+			OP(0xBE): { unsigned data; READ(data, hl()); cp_a_u8(data); } NEXT_OP;
 
 				// A always equals A:
-			case 0xBF:
+			OP(0xBF):
 				cf = zf = 0;
 				hf2 = hf2_subf;
-				break;
+				NEXT_OP;
 
 				// ret nz (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if ZF is unset:
-			case 0xC0:
+			OP(0xC0):
 				cycleCounter += 4;
 
 				if (zf & 0xFF)
 					ret();
 
-				break;
+				NEXT_OP;
 
-			case 0xC1:
+			OP(0xC1):
 				pop_rr(b, c);
-				break;
+				NEXT_OP;
 
 				// jp nz,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if ZF is unset:
-			case 0xC2:
+			OP(0xC2):
 				if (zf & 0xFF) {
 					jp_nn();
 				} else {
@@ -1160,16 +1557,16 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xC3:
+			OP(0xC3):
 				jp_nn();
-				break;
+				NEXT_OP;
 
 				// call nz,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if ZF is unset:
-			case 0xC4:
+			OP(0xC4):
 				if (zf & 0xFF) {
 					call_nn();
 				} else {
@@ -1177,43 +1574,43 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xC5:
+			OP(0xC5):
 				push_rr(b, c);
-				break;
-			case 0xC6:
+				NEXT_OP;
+			OP(0xC6):
 				{
 					unsigned data;
 					PC_READ(data);
 					add_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xC7:
+			OP(0xC7):
 				rst_n(0x00);
-				break;
+				NEXT_OP;
 
 				// ret z (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if ZF is set:
-			case 0xC8:
+			OP(0xC8):
 				cycleCounter += 4;
 
 				if (!(zf & 0xFF))
 					ret();
 
-				break;
+				NEXT_OP;
 
 				// ret (16 cycles):
 				// Pop two bytes from the stack and jump to that address:
-			case 0xC9:
+			OP(0xC9):
 				ret();
-				break;
+				NEXT_OP;
 
 				// jp z,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if ZF is set:
-			case 0xCA:
+			OP(0xCA):
 				if (zf & 0xFF) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1221,25 +1618,27 @@ void CPU::process(unsigned long const cycles) {
 					jp_nn();
 				}
 
-				break;
+				NEXT_OP;
 
 
 				// CB OPCODES (Shifts, rotates and bits):
-			case 0xCB:
+			OP(0xCB):
 				PC_READ(opcode);
+				PROFILE_CB_OP(opcode);
 
+				DISPATCH(cbtable, opcode);
 				switch (opcode) {
-				case 0x00: rlc_r(b); break;
-				case 0x01: rlc_r(c); break;
-				case 0x02: rlc_r(d); break;
-				case 0x03: rlc_r(e); break;
-				case 0x04: rlc_r(h); break;
-				case 0x05: rlc_r(l); break;
+				CB_OP(0x00): rlc_r(b); NEXT_OP;
+				CB_OP(0x01): rlc_r(c); NEXT_OP;
+				CB_OP(0x02): rlc_r(d); NEXT_OP;
+				CB_OP(0x03): rlc_r(e); NEXT_OP;
+				CB_OP(0x04): rlc_r(h); NEXT_OP;
+				CB_OP(0x05): rlc_r(l); NEXT_OP;
 
 					// rlc (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL left, store old bit7 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x06:
+				CB_OP(0x06):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1249,21 +1648,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x07: rlc_r(a); break;
+				CB_OP(0x07): rlc_r(a); NEXT_OP;
 
-				case 0x08: rrc_r(b); break;
-				case 0x09: rrc_r(c); break;
-				case 0x0A: rrc_r(d); break;
-				case 0x0B: rrc_r(e); break;
-				case 0x0C: rrc_r(h); break;
-				case 0x0D: rrc_r(l); break;
+				CB_OP(0x08): rrc_r(b); NEXT_OP;
+				CB_OP(0x09): rrc_r(c); NEXT_OP;
+				CB_OP(0x0A): rrc_r(d); NEXT_OP;
+				CB_OP(0x0B): rrc_r(e); NEXT_OP;
+				CB_OP(0x0C): rrc_r(h); NEXT_OP;
+				CB_OP(0x0D): rrc_r(l); NEXT_OP;
 
 					// rrc (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL right, store old bit0 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x0E:
+				CB_OP(0x0E):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1272,21 +1671,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x0F: rrc_r(a); break;
+				CB_OP(0x0F): rrc_r(a); NEXT_OP;
 
-				case 0x10: rl_r(b); break;
-				case 0x11: rl_r(c); break;
-				case 0x12: rl_r(d); break;
-				case 0x13: rl_r(e); break;
-				case 0x14: rl_r(h); break;
-				case 0x15: rl_r(l); break;
+				CB_OP(0x10): rl_r(b); NEXT_OP;
+				CB_OP(0x11): rl_r(c); NEXT_OP;
+				CB_OP(0x12): rl_r(d); NEXT_OP;
+				CB_OP(0x13): rl_r(e); NEXT_OP;
+				CB_OP(0x14): rl_r(h); NEXT_OP;
+				CB_OP(0x15): rl_r(l); NEXT_OP;
 
 					// rl (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL left thorugh CF,
 					// store old bit7 in CF, old CF value becoms bit0. Reset SF and HCF. Check ZF:
-				case 0x16:
+				CB_OP(0x16):
 					{
 						unsigned const addr = hl();
 						unsigned const oldcf = cf >> 8 & 1;
@@ -1296,21 +1695,21 @@ void CPU::process(unsigned long const cycles) {
 						WRITE(addr, zf & 0xFF);
 						hf2 = 0;
 					}
-					break;
+					NEXT_OP;
 
-				case 0x17: rl_r(a); break;
+				CB_OP(0x17): rl_r(a); NEXT_OP;
 
-				case 0x18: rr_r(b); break;
-				case 0x19: rr_r(c); break;
-				case 0x1A: rr_r(d); break;
-				case 0x1B: rr_r(e); break;
-				case 0x1C: rr_r(h); break;
-				case 0x1D: rr_r(l); break;
+				CB_OP(0x18): rr_r(b); NEXT_OP;
+				CB_OP(0x19): rr_r(c); NEXT_OP;
+				CB_OP(0x1A): rr_r(d); NEXT_OP;
+				CB_OP(0x1B): rr_r(e); NEXT_OP;
+				CB_OP(0x1C): rr_r(h); NEXT_OP;
+				CB_OP(0x1D): rr_r(l); NEXT_OP;
 
 					// rr (hl) (16 cycles):
 					// Rotate 8-bit value stored at address in HL right thorugh CF,
 					// store old bit0 in CF, old CF value becoms bit7. Reset SF and HCF. Check ZF:
-				case 0x1E:
+				CB_OP(0x1E):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1322,21 +1721,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x1F: rr_r(a); break;
+				CB_OP(0x1F): rr_r(a); NEXT_OP;
 
-				case 0x20: sla_r(b); break;
-				case 0x21: sla_r(c); break;
-				case 0x22: sla_r(d); break;
-				case 0x23: sla_r(e); break;
-				case 0x24: sla_r(h); break;
-				case 0x25: sla_r(l); break;
+				CB_OP(0x20): sla_r(b); NEXT_OP;
+				CB_OP(0x21): sla_r(c); NEXT_OP;
+				CB_OP(0x22): sla_r(d); NEXT_OP;
+				CB_OP(0x23): sla_r(e); NEXT_OP;
+				CB_OP(0x24): sla_r(h); NEXT_OP;
+				CB_OP(0x25): sla_r(l); NEXT_OP;
 
 					// sla (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL left, store old bit7 in CF.
 					// Reset SF and HCF. Check ZF:
-				case 0x26:
+				CB_OP(0x26):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1346,21 +1745,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x27: sla_r(a); break;
+				CB_OP(0x27): sla_r(a); NEXT_OP;
 
-				case 0x28: sra_r(b); break;
-				case 0x29: sra_r(c); break;
-				case 0x2A: sra_r(d); break;
-				case 0x2B: sra_r(e); break;
-				case 0x2C: sra_r(h); break;
-				case 0x2D: sra_r(l); break;
+				CB_OP(0x28): sra_r(b); NEXT_OP;
+				CB_OP(0x29): sra_r(c); NEXT_OP;
+				CB_OP(0x2A): sra_r(d); NEXT_OP;
+				CB_OP(0x2B): sra_r(e); NEXT_OP;
+				CB_OP(0x2C): sra_r(h); NEXT_OP;
+				CB_OP(0x2D): sra_r(l); NEXT_OP;
 
 					// sra (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL right, store old bit0 in CF,
 					// bit7=old bit7. Reset SF and HCF. Check ZF:
-				case 0x2E:
+				CB_OP(0x2E):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1370,21 +1769,21 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x2F: sra_r(a); break;
+				CB_OP(0x2F): sra_r(a); NEXT_OP;
 
-				case 0x30: swap_r(b); break;
-				case 0x31: swap_r(c); break;
-				case 0x32: swap_r(d); break;
-				case 0x33: swap_r(e); break;
-				case 0x34: swap_r(h); break;
-				case 0x35: swap_r(l); break;
+				CB_OP(0x30): swap_r(b); NEXT_OP;
+				CB_OP(0x31): swap_r(c); NEXT_OP;
+				CB_OP(0x32): swap_r(d); NEXT_OP;
+				CB_OP(0x33): swap_r(e); NEXT_OP;
+				CB_OP(0x34): swap_r(h); NEXT_OP;
+				CB_OP(0x35): swap_r(l); NEXT_OP;
 
 					// swap (hl) (16 cycles):
 					// Swap upper and lower nibbles of 8-bit value stored at address in HL,
 					// reset flags, check zero flag:
-				case 0x36:
+				CB_OP(0x36):
 					{
 						unsigned const addr = hl();
 						READ(zf, addr);
@@ -1392,21 +1791,21 @@ void CPU::process(unsigned long const cycles) {
 						cf = hf2 = 0;
 					}
 
-					break;
+					NEXT_OP;
 
-				case 0x37: swap_r(a); break;
+				CB_OP(0x37): swap_r(a); NEXT_OP;
 
-				case 0x38: srl_r(b); break;
-				case 0x39: srl_r(c); break;
-				case 0x3A: srl_r(d); break;
-				case 0x3B: srl_r(e); break;
-				case 0x3C: srl_r(h); break;
-				case 0x3D: srl_r(l); break;
+				CB_OP(0x38): srl_r(b); NEXT_OP;
+				CB_OP(0x39): srl_r(c); NEXT_OP;
+				CB_OP(0x3A): srl_r(d); NEXT_OP;
+				CB_OP(0x3B): srl_r(e); NEXT_OP;
+				CB_OP(0x3C): srl_r(h); NEXT_OP;
+				CB_OP(0x3D): srl_r(l); NEXT_OP;
 
 					// srl (hl) (16 cycles):
 					// Shift 8-bit value stored at address in HL right,
 					// store old bit0 in CF. Reset SF and HCF. Check ZF:
-				case 0x3E:
+				CB_OP(0x3E):
 					{
 						unsigned const addr = hl();
 						READ(cf, addr);
@@ -1416,234 +1815,234 @@ void CPU::process(unsigned long const cycles) {
 						hf2 = 0;
 					}
 
-					break;
-
-				case 0x3F: srl_r(a); break;
-
-				case 0x40: bit0_u8(b); break;
-				case 0x41: bit0_u8(c); break;
-				case 0x42: bit0_u8(d); break;
-				case 0x43: bit0_u8(e); break;
-				case 0x44: bit0_u8(h); break;
-				case 0x45: bit0_u8(l); break;
-				case 0x46: { unsigned data; READ(data, hl()); bit0_u8(data); } break;
-				case 0x47: bit0_u8(a); break;
-
-				case 0x48: bit1_u8(b); break;
-				case 0x49: bit1_u8(c); break;
-				case 0x4A: bit1_u8(d); break;
-				case 0x4B: bit1_u8(e); break;
-				case 0x4C: bit1_u8(h); break;
-				case 0x4D: bit1_u8(l); break;
-				case 0x4E: { unsigned data; READ(data, hl()); bit1_u8(data); } break;
-				case 0x4F: bit1_u8(a); break;
-
-				case 0x50: bit2_u8(b); break;
-				case 0x51: bit2_u8(c); break;
-				case 0x52: bit2_u8(d); break;
-				case 0x53: bit2_u8(e); break;
-				case 0x54: bit2_u8(h); break;
-				case 0x55: bit2_u8(l); break;
-				case 0x56: { unsigned data; READ(data, hl()); bit2_u8(data); } break;
-				case 0x57: bit2_u8(a); break;
-
-				case 0x58: bit3_u8(b); break;
-				case 0x59: bit3_u8(c); break;
-				case 0x5A: bit3_u8(d); break;
-				case 0x5B: bit3_u8(e); break;
-				case 0x5C: bit3_u8(h); break;
-				case 0x5D: bit3_u8(l); break;
-				case 0x5E: { unsigned data; READ(data, hl()); bit3_u8(data); } break;
-				case 0x5F: bit3_u8(a); break;
-
-				case 0x60: bit4_u8(b); break;
-				case 0x61: bit4_u8(c); break;
-				case 0x62: bit4_u8(d); break;
-				case 0x63: bit4_u8(e); break;
-				case 0x64: bit4_u8(h); break;
-				case 0x65: bit4_u8(l); break;
-				case 0x66: { unsigned data; READ(data, hl()); bit4_u8(data); } break;
-				case 0x67: bit4_u8(a); break;
-
-				case 0x68: bit5_u8(b); break;
-				case 0x69: bit5_u8(c); break;
-				case 0x6A: bit5_u8(d); break;
-				case 0x6B: bit5_u8(e); break;
-				case 0x6C: bit5_u8(h); break;
-				case 0x6D: bit5_u8(l); break;
-				case 0x6E: { unsigned data; READ(data, hl()); bit5_u8(data); } break;
-				case 0x6F: bit5_u8(a); break;
-
-				case 0x70: bit6_u8(b); break;
-				case 0x71: bit6_u8(c); break;
-				case 0x72: bit6_u8(d); break;
-				case 0x73: bit6_u8(e); break;
-				case 0x74: bit6_u8(h); break;
-				case 0x75: bit6_u8(l); break;
-				case 0x76: { unsigned data; READ(data, hl()); bit6_u8(data); } break;
-				case 0x77: bit6_u8(a); break;
-
-				case 0x78: bit7_u8(b); break;
-				case 0x79: bit7_u8(c); break;
-				case 0x7A: bit7_u8(d); break;
-				case 0x7B: bit7_u8(e); break;
-				case 0x7C: bit7_u8(h); break;
-				case 0x7D: bit7_u8(l); break;
-				case 0x7E: { unsigned data; READ(data, hl()); bit7_u8(data); } break;
-				case 0x7F: bit7_u8(a); break;
-
-				case 0x80: res0_r(b); break;
-				case 0x81: res0_r(c); break;
-				case 0x82: res0_r(d); break;
-				case 0x83: res0_r(e); break;
-				case 0x84: res0_r(h); break;
-				case 0x85: res0_r(l); break;
-				case 0x86: resn_mem_hl(0); break;
-				case 0x87: res0_r(a); break;
-
-				case 0x88: res1_r(b); break;
-				case 0x89: res1_r(c); break;
-				case 0x8A: res1_r(d); break;
-				case 0x8B: res1_r(e); break;
-				case 0x8C: res1_r(h); break;
-				case 0x8D: res1_r(l); break;
-				case 0x8E: resn_mem_hl(1); break;
-				case 0x8F: res1_r(a); break;
-
-				case 0x90: res2_r(b); break;
-				case 0x91: res2_r(c); break;
-				case 0x92: res2_r(d); break;
-				case 0x93: res2_r(e); break;
-				case 0x94: res2_r(h); break;
-				case 0x95: res2_r(l); break;
-				case 0x96: resn_mem_hl(2); break;
-				case 0x97: res2_r(a); break;
-
-				case 0x98: res3_r(b); break;
-				case 0x99: res3_r(c); break;
-				case 0x9A: res3_r(d); break;
-				case 0x9B: res3_r(e); break;
-				case 0x9C: res3_r(h); break;
-				case 0x9D: res3_r(l); break;
-				case 0x9E: resn_mem_hl(3); break;
-				case 0x9F: res3_r(a); break;
-
-				case 0xA0: res4_r(b); break;
-				case 0xA1: res4_r(c); break;
-				case 0xA2: res4_r(d); break;
-				case 0xA3: res4_r(e); break;
-				case 0xA4: res4_r(h); break;
-				case 0xA5: res4_r(l); break;
-				case 0xA6: resn_mem_hl(4); break;
-				case 0xA7: res4_r(a); break;
-
-				case 0xA8: res5_r(b); break;
-				case 0xA9: res5_r(c); break;
-				case 0xAA: res5_r(d); break;
-				case 0xAB: res5_r(e); break;
-				case 0xAC: res5_r(h); break;
-				case 0xAD: res5_r(l); break;
-				case 0xAE: resn_mem_hl(5); break;
-				case 0xAF: res5_r(a); break;
-
-				case 0xB0: res6_r(b); break;
-				case 0xB1: res6_r(c); break;
-				case 0xB2: res6_r(d); break;
-				case 0xB3: res6_r(e); break;
-				case 0xB4: res6_r(h); break;
-				case 0xB5: res6_r(l); break;
-				case 0xB6: resn_mem_hl(6); break;
-				case 0xB7: res6_r(a); break;
-
-				case 0xB8: res7_r(b); break;
-				case 0xB9: res7_r(c); break;
-				case 0xBA: res7_r(d); break;
-				case 0xBB: res7_r(e); break;
-				case 0xBC: res7_r(h); break;
-				case 0xBD: res7_r(l); break;
-				case 0xBE: resn_mem_hl(7); break;
-				case 0xBF: res7_r(a); break;
-
-				case 0xC0: set0_r(b); break;
-				case 0xC1: set0_r(c); break;
-				case 0xC2: set0_r(d); break;
-				case 0xC3: set0_r(e); break;
-				case 0xC4: set0_r(h); break;
-				case 0xC5: set0_r(l); break;
-				case 0xC6: setn_mem_hl(0); break;
-				case 0xC7: set0_r(a); break;
-
-				case 0xC8: set1_r(b); break;
-				case 0xC9: set1_r(c); break;
-				case 0xCA: set1_r(d); break;
-				case 0xCB: set1_r(e); break;
-				case 0xCC: set1_r(h); break;
-				case 0xCD: set1_r(l); break;
-				case 0xCE: setn_mem_hl(1); break;
-				case 0xCF: set1_r(a); break;
-
-				case 0xD0: set2_r(b); break;
-				case 0xD1: set2_r(c); break;
-				case 0xD2: set2_r(d); break;
-				case 0xD3: set2_r(e); break;
-				case 0xD4: set2_r(h); break;
-				case 0xD5: set2_r(l); break;
-				case 0xD6: setn_mem_hl(2); break;
-				case 0xD7: set2_r(a); break;
-
-				case 0xD8: set3_r(b); break;
-				case 0xD9: set3_r(c); break;
-				case 0xDA: set3_r(d); break;
-				case 0xDB: set3_r(e); break;
-				case 0xDC: set3_r(h); break;
-				case 0xDD: set3_r(l); break;
-				case 0xDE: setn_mem_hl(3); break;
-				case 0xDF: set3_r(a); break;
-
-				case 0xE0: set4_r(b); break;
-				case 0xE1: set4_r(c); break;
-				case 0xE2: set4_r(d); break;
-				case 0xE3: set4_r(e); break;
-				case 0xE4: set4_r(h); break;
-				case 0xE5: set4_r(l); break;
-				case 0xE6: setn_mem_hl(4); break;
-				case 0xE7: set4_r(a); break;
-
-				case 0xE8: set5_r(b); break;
-				case 0xE9: set5_r(c); break;
-				case 0xEA: set5_r(d); break;
-				case 0xEB: set5_r(e); break;
-				case 0xEC: set5_r(h); break;
-				case 0xED: set5_r(l); break;
-				case 0xEE: setn_mem_hl(5); break;
-				case 0xEF: set5_r(a); break;
-
-				case 0xF0: set6_r(b); break;
-				case 0xF1: set6_r(c); break;
-				case 0xF2: set6_r(d); break;
-				case 0xF3: set6_r(e); break;
-				case 0xF4: set6_r(h); break;
-				case 0xF5: set6_r(l); break;
-				case 0xF6: setn_mem_hl(6); break;
-				case 0xF7: set6_r(a); break;
-
-				case 0xF8: set7_r(b); break;
-				case 0xF9: set7_r(c); break;
-				case 0xFA: set7_r(d); break;
-				case 0xFB: set7_r(e); break;
-				case 0xFC: set7_r(h); break;
-				case 0xFD: set7_r(l); break;
-				case 0xFE: setn_mem_hl(7); break;
-				case 0xFF: set7_r(a); break;
+					NEXT_OP;
+
+				CB_OP(0x3F): srl_r(a); NEXT_OP;
+
+				CB_OP(0x40): bit0_u8(b); NEXT_OP;
+				CB_OP(0x41): bit0_u8(c); NEXT_OP;
+				CB_OP(0x42): bit0_u8(d); NEXT_OP;
+				CB_OP(0x43): bit0_u8(e); NEXT_OP;
+				CB_OP(0x44): bit0_u8(h); NEXT_OP;
+				CB_OP(0x45): bit0_u8(l); NEXT_OP;
+				CB_OP(0x46): { unsigned data; READ(data, hl()); bit0_u8(data); } NEXT_OP;
+				CB_OP(0x47): bit0_u8(a); NEXT_OP;
+
+				CB_OP(0x48): bit1_u8(b); NEXT_OP;
+				CB_OP(0x49): bit1_u8(c); NEXT_OP;
+				CB_OP(0x4A): bit1_u8(d); NEXT_OP;
+				CB_OP(0x4B): bit1_u8(e); NEXT_OP;
+				CB_OP(0x4C): bit1_u8(h); NEXT_OP;
+				CB_OP(0x4D): bit1_u8(l); NEXT_OP;
+				CB_OP(0x4E): { unsigned data; READ(data, hl()); bit1_u8(data); } NEXT_OP;
+				CB_OP(0x4F): bit1_u8(a); NEXT_OP;
+
+				CB_OP(0x50): bit2_u8(b); NEXT_OP;
+				CB_OP(0x51): bit2_u8(c); NEXT_OP;
+				CB_OP(0x52): bit2_u8(d); NEXT_OP;
+				CB_OP(0x53): bit2_u8(e); NEXT_OP;
+				CB_OP(0x54): bit2_u8(h); NEXT_OP;
+				CB_OP(0x55): bit2_u8(l); NEXT_OP;
+				CB_OP(0x56): { unsigned data; READ(data, hl()); bit2_u8(data); } NEXT_OP;
+				CB_OP(0x57): bit2_u8(a); NEXT_OP;
+
+				CB_OP(0x58): bit3_u8(b); NEXT_OP;
+				CB_OP(0x59): bit3_u8(c); NEXT_OP;
+				CB_OP(0x5A): bit3_u8(d); NEXT_OP;
+				CB_OP(0x5B): bit3_u8(e); NEXT_OP;
+				CB_OP(0x5C): bit3_u8(h); NEXT_OP;
+				CB_OP(0x5D): bit3_u8(l); NEXT_OP;
+				CB_OP(0x5E): { unsigned data; READ(data, hl()); bit3_u8(data); } NEXT_OP;
+				CB_OP(0x5F): bit3_u8(a); NEXT_OP;
+
+				CB_OP(0x60): bit4_u8(b); NEXT_OP;
+				CB_OP(0x61): bit4_u8(c); NEXT_OP;
+				CB_OP(0x62): bit4_u8(d); NEXT_OP;
+				CB_OP(0x63): bit4_u8(e); NEXT_OP;
+				CB_OP(0x64): bit4_u8(h); NEXT_OP;
+				CB_OP(0x65): bit4_u8(l); NEXT_OP;
+				CB_OP(0x66): { unsigned data; READ(data, hl()); bit4_u8(data); } NEXT_OP;
+				CB_OP(0x67): bit4_u8(a); NEXT_OP;
+
+				CB_OP(0x68): bit5_u8(b); NEXT_OP;
+				CB_OP(0x69): bit5_u8(c); NEXT_OP;
+				CB_OP(0x6A): bit5_u8(d); NEXT_OP;
+				CB_OP(0x6B): bit5_u8(e); NEXT_OP;
+				CB_OP(0x6C): bit5_u8(h); NEXT_OP;
+				CB_OP(0x6D): bit5_u8(l); NEXT_OP;
+				CB_OP(0x6E): { unsigned data; READ(data, hl()); bit5_u8(data); } NEXT_OP;
+				CB_OP(0x6F): bit5_u8(a); NEXT_OP;
+
+				CB_OP(0x70): bit6_u8(b); NEXT_OP;
+				CB_OP(0x71): bit6_u8(c); NEXT_OP;
+				CB_OP(0x72): bit6_u8(d); NEXT_OP;
+				CB_OP(0x73): bit6_u8(e); NEXT_OP;
+				CB_OP(0x74): bit6_u8(h); NEXT_OP;
+				CB_OP(0x75): bit6_u8(l); NEXT_OP;
+				CB_OP(0x76): { unsigned data; READ(data, hl()); bit6_u8(data); } NEXT_OP;
+				CB_OP(0x77): bit6_u8(a); NEXT_OP;
+
+				CB_OP(0x78): bit7_u8(b); NEXT_OP;
+				CB_OP(0x79): bit7_u8(c); NEXT_OP;
+				CB_OP(0x7A): bit7_u8(d); NEXT_OP;
+				CB_OP(0x7B): bit7_u8(e); NEXT_OP;
+				CB_OP(0x7C): bit7_u8(h); NEXT_OP;
+				CB_OP(0x7D): bit7_u8(l); NEXT_OP;
+				CB_OP(0x7E): { unsigned data; READ(data, hl()); bit7_u8(data); } NEXT_OP;
+				CB_OP(0x7F): bit7_u8(a); NEXT_OP;
+
+				CB_OP(0x80): res0_r(b); NEXT_OP;
+				CB_OP(0x81): res0_r(c); NEXT_OP;
+				CB_OP(0x82): res0_r(d); NEXT_OP;
+				CB_OP(0x83): res0_r(e); NEXT_OP;
+				CB_OP(0x84): res0_r(h); NEXT_OP;
+				CB_OP(0x85): res0_r(l); NEXT_OP;
+				CB_OP(0x86): resn_mem_hl(0); NEXT_OP;
+				CB_OP(0x87): res0_r(a); NEXT_OP;
+
+				CB_OP(0x88): res1_r(b); NEXT_OP;
+				CB_OP(0x89): res1_r(c); NEXT_OP;
+				CB_OP(0x8A): res1_r(d); NEXT_OP;
+				CB_OP(0x8B): res1_r(e); NEXT_OP;
+				CB_OP(0x8C): res1_r(h); NEXT_OP;
+				CB_OP(0x8D): res1_r(l); NEXT_OP;
+				CB_OP(0x8E): resn_mem_hl(1); NEXT_OP;
+				CB_OP(0x8F): res1_r(a); NEXT_OP;
+
+				CB_OP(0x90): res2_r(b); NEXT_OP;
+				CB_OP(0x91): res2_r(c); NEXT_OP;
+				CB_OP(0x92): res2_r(d); NEXT_OP;
+				CB_OP(0x93): res2_r(e); NEXT_OP;
+				CB_OP(0x94): res2_r(h); NEXT_OP;
+				CB_OP(0x95): res2_r(l); NEXT_OP;
+				CB_OP(0x96): resn_mem_hl(2); NEXT_OP;
+				CB_OP(0x97): res2_r(a); NEXT_OP;
+
+				CB_OP(0x98): res3_r(b); NEXT_OP;
+				CB_OP(0x99): res3_r(c); NEXT_OP;
+				CB_OP(0x9A): res3_r(d); NEXT_OP;
+				CB_OP(0x9B): res3_r(e); NEXT_OP;
+				CB_OP(0x9C): res3_r(h); NEXT_OP;
+				CB_OP(0x9D): res3_r(l); NEXT_OP;
+				CB_OP(0x9E): resn_mem_hl(3); NEXT_OP;
+				CB_OP(0x9F): res3_r(a); NEXT_OP;
+
+				CB_OP(0xA0): res4_r(b); NEXT_OP;
+				CB_OP(0xA1): res4_r(c); NEXT_OP;
+				CB_OP(0xA2): res4_r(d); NEXT_OP;
+				CB_OP(0xA3): res4_r(e); NEXT_OP;
+				CB_OP(0xA4): res4_r(h); NEXT_OP;
+				CB_OP(0xA5): res4_r(l); NEXT_OP;
+				CB_OP(0xA6): resn_mem_hl(4); NEXT_OP;
+				CB_OP(0xA7): res4_r(a); NEXT_OP;
+
+				CB_OP(0xA8): res5_r(b); NEXT_OP;
+				CB_OP(0xA9): res5_r(c); NEXT_OP;
+				CB_OP(0xAA): res5_r(d); NEXT_OP;
+				CB_OP(0xAB): res5_r(e); NEXT_OP;
+				CB_OP(0xAC): res5_r(h); NEXT_OP;
+				CB_OP(0xAD): res5_r(l); NEXT_OP;
+				CB_OP(0xAE): resn_mem_hl(5); NEXT_OP;
+				CB_OP(0xAF): res5_r(a); NEXT_OP;
+
+				CB_OP(0xB0): res6_r(b); NEXT_OP;
+				CB_OP(0xB1): res6_r(c); NEXT_OP;
+				CB_OP(0xB2): res6_r(d); NEXT_OP;
+				CB_OP(0xB3): res6_r(e); NEXT_OP;
+				CB_OP(0xB4): res6_r(h); NEXT_OP;
+				CB_OP(0xB5): res6_r(l); NEXT_OP;
+				CB_OP(0xB6): resn_mem_hl(6); NEXT_OP;
+				CB_OP(0xB7): res6_r(a); NEXT_OP;
+
+				CB_OP(0xB8): res7_r(b); NEXT_OP;
+				CB_OP(0xB9): res7_r(c); NEXT_OP;
+				CB_OP(0xBA): res7_r(d); NEXT_OP;
+				CB_OP(0xBB): res7_r(e); NEXT_OP;
+				CB_OP(0xBC): res7_r(h); NEXT_OP;
+				CB_OP(0xBD): res7_r(l); NEXT_OP;
+				CB_OP(0xBE): resn_mem_hl(7); NEXT_OP;
+				CB_OP(0xBF): res7_r(a); NEXT_OP;
+
+				CB_OP(0xC0): set0_r(b); NEXT_OP;
+				CB_OP(0xC1): set0_r(c); NEXT_OP;
+				CB_OP(0xC2): set0_r(d); NEXT_OP;
+				CB_OP(0xC3): set0_r(e); NEXT_OP;
+				CB_OP(0xC4): set0_r(h); NEXT_OP;
+				CB_OP(0xC5): set0_r(l); NEXT_OP;
+				CB_OP(0xC6): setn_mem_hl(0); NEXT_OP;
+				CB_OP(0xC7): set0_r(a); NEXT_OP;
+
+				CB_OP(0xC8): set1_r(b); NEXT_OP;
+				CB_OP(0xC9): set1_r(c); NEXT_OP;
+				CB_OP(0xCA): set1_r(d); NEXT_OP;
+				CB_OP(0xCB): set1_r(e); NEXT_OP;
+				CB_OP(0xCC): set1_r(h); NEXT_OP;
+				CB_OP(0xCD): set1_r(l); NEXT_OP;
+				CB_OP(0xCE): setn_mem_hl(1); NEXT_OP;
+				CB_OP(0xCF): set1_r(a); NEXT_OP;
+
+				CB_OP(0xD0): set2_r(b); NEXT_OP;
+				CB_OP(0xD1): set2_r(c); NEXT_OP;
+				CB_OP(0xD2): set2_r(d); NEXT_OP;
+				CB_OP(0xD3): set2_r(e); NEXT_OP;
+				CB_OP(0xD4): set2_r(h); NEXT_OP;
+				CB_OP(0xD5): set2_r(l); NEXT_OP;
+				CB_OP(0xD6): setn_mem_hl(2); NEXT_OP;
+				CB_OP(0xD7): set2_r(a); NEXT_OP;
+
+				CB_OP(0xD8): set3_r(b); NEXT_OP;
+				CB_OP(0xD9): set3_r(c); NEXT_OP;
+				CB_OP(0xDA): set3_r(d); NEXT_OP;
+				CB_OP(0xDB): set3_r(e); NEXT_OP;
+				CB_OP(0xDC): set3_r(h); NEXT_OP;
+				CB_OP(0xDD): set3_r(l); NEXT_OP;
+				CB_OP(0xDE): setn_mem_hl(3); NEXT_OP;
+				CB_OP(0xDF): set3_r(a); NEXT_OP;
+
+				CB_OP(0xE0): set4_r(b); NEXT_OP;
+				CB_OP(0xE1): set4_r(c); NEXT_OP;
+				CB_OP(0xE2): set4_r(d); NEXT_OP;
+				CB_OP(0xE3): set4_r(e); NEXT_OP;
+				CB_OP(0xE4): set4_r(h); NEXT_OP;
+				CB_OP(0xE5): set4_r(l); NEXT_OP;
+				CB_OP(0xE6): setn_mem_hl(4); NEXT_OP;
+				CB_OP(0xE7): set4_r(a); NEXT_OP;
+
+				CB_OP(0xE8): set5_r(b); NEXT_OP;
+				CB_OP(0xE9): set5_r(c); NEXT_OP;
+				CB_OP(0xEA): set5_r(d); NEXT_OP;
+				CB_OP(0xEB): set5_r(e); NEXT_OP;
+				CB_OP(0xEC): set5_r(h); NEXT_OP;
+				CB_OP(0xED): set5_r(l); NEXT_OP;
+				CB_OP(0xEE): setn_mem_hl(5); NEXT_OP;
+				CB_OP(0xEF): set5_r(a); NEXT_OP;
+
+				CB_OP(0xF0): set6_r(b); NEXT_OP;
+				CB_OP(0xF1): set6_r(c); NEXT_OP;
+				CB_OP(0xF2): set6_r(d); NEXT_OP;
+				CB_OP(0xF3): set6_r(e); NEXT_OP;
+				CB_OP(0xF4): set6_r(h); NEXT_OP;
+				CB_OP(0xF5): set6_r(l); NEXT_OP;
+				CB_OP(0xF6): setn_mem_hl(6); NEXT_OP;
+				CB_OP(0xF7): set6_r(a); NEXT_OP;
+
+				CB_OP(0xF8): set7_r(b); NEXT_OP;
+				CB_OP(0xF9): set7_r(c); NEXT_OP;
+				CB_OP(0xFA): set7_r(d); NEXT_OP;
+				CB_OP(0xFB): set7_r(e); NEXT_OP;
+				CB_OP(0xFC): set7_r(h); NEXT_OP;
+				CB_OP(0xFD): set7_r(l); NEXT_OP;
+				CB_OP(0xFE): setn_mem_hl(7); NEXT_OP;
+				CB_OP(0xFF): set7_r(a); NEXT_OP;
 				}
 
-				break;
+				NEXT_OP;
 
 
 				// call z,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if ZF is set:
-			case 0xCC:
+			OP(0xCC):
 				if (zf & 0xFF) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1651,42 +2050,42 @@ void CPU::process(unsigned long const cycles) {
 					call_nn();
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xCD:
+			OP(0xCD):
 				call_nn();
-				break;
+				NEXT_OP;
 
-			case 0xCE:
+			OP(0xCE):
 				{
 					unsigned data;
 					PC_READ(data);
 					adc_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xCF:
+			OP(0xCF):
 				rst_n(0x08);
-				break;
+				NEXT_OP;
 
 				// ret nc (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if CF is unset:
-			case 0xD0:
+			OP(0xD0):
 				cycleCounter += 4;
 
 				if (!(cf & 0x100))
 					ret();
 
-				break;
+				NEXT_OP;
 
-			case 0xD1:
+			OP(0xD1):
 				pop_rr(d, e);
-				break;
+				NEXT_OP;
 
 				// jp nc,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if CF is unset:
-			case 0xD2:
+			OP(0xD2):
 				if (cf & 0x100) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1694,16 +2093,16 @@ void CPU::process(unsigned long const cycles) {
 					jp_nn();
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xD3: // not specified. should freeze.
+			OP(0xD3): // not specified. should freeze.
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
 				// call nc,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if CF is unset:
-			case 0xD4:
+			OP(0xD4):
 				if (cf & 0x100) {
 					PC_MOD((pc + 2) & 0xFFFF);
 					cycleCounter += 4;
@@ -1711,38 +2110,38 @@ void CPU::process(unsigned long const cycles) {
 					call_nn();
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xD5:
+			OP(0xD5):
 				push_rr(d, e);
-				break;
+				NEXT_OP;
 
-			case 0xD6:
+			OP(0xD6):
 				{
 					unsigned data;
 					PC_READ(data);
 					sub_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xD7:
+			OP(0xD7):
 				rst_n(0x10);
-				break;
+				NEXT_OP;
 
 				// ret c (20;8 cycles):
 				// Pop two bytes from the stack and jump to that address, if CF is set:
-			case 0xD8:
+			OP(0xD8):
 				cycleCounter += 4;
 
 				if (cf & 0x100)
 					ret();
 
-				break;
+				NEXT_OP;
 
 				// reti (16 cycles):
 				// Pop two bytes from the stack and jump to that address, then enable interrupts:
-			case 0xD9:
+			OP(0xD9):
 				{
 					unsigned sl, sh;
 					pop_rr(sh, sl);
@@ -1750,11 +2149,11 @@ void CPU::process(unsigned long const cycles) {
 					PC_MOD(sh << 8 | sl);
 				}
 
-				break;
+				NEXT_OP;
 
 				// jp c,nn (16;12 cycles):
 				// Jump to address stored in next two bytes in memory if CF is set:
-			case 0xDA:
+			OP(0xDA):
 				if (cf & 0x100) {
 					jp_nn();
 				} else {
@@ -1762,16 +2161,16 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xDB: // not specified. should freeze.
+			OP(0xDB): // not specified. should freeze.
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
 				// call z,nn (24;12 cycles):
 				// Push address of next instruction onto stack and then jump to
 				// address stored in next two bytes in memory, if CF is set:
-			case 0xDC:
+			OP(0xDC):
 				if (cf & 0x100) {
 					call_nn();
 				} else {
@@ -1779,81 +2178,81 @@ void CPU::process(unsigned long const cycles) {
 					cycleCounter += 4;
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xDE:
+			OP(0xDE):
 				{
 					unsigned data;
 					PC_READ(data);
 					sbc_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xDF:
+			OP(0xDF):
 				rst_n(0x18);
-				break;
+				NEXT_OP;
 
 				// ld ($FF00+n),a (12 cycles):
 				// Put value in A into address (0xFF00 + next byte in memory):
-			case 0xE0:
+			OP(0xE0):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					FF_WRITE(imm, a);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xE1:
+			OP(0xE1):
 				pop_rr(h, l);
-				break;
+				NEXT_OP;
 
 				// ld ($FF00+C),a (8 ycles):
 				// Put A into address (0xFF00 + register C):
-			case 0xE2:
+			OP(0xE2):
 				FF_WRITE(c, a);
-				break;
+				NEXT_OP;
 
-			case 0xE3: // not specified. should freeze.
-			case 0xE4: // not specified. should freeze.
+			OP(0xE3): // not specified. should freeze.
+			OP(0xE4): // not specified. should freeze.
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
-			case 0xE5:
+			OP(0xE5):
 				push_rr(h, l);
-				break;
+				NEXT_OP;
 
-			case 0xE6:
+			OP(0xE6):
 				{
 					unsigned data;
 					PC_READ(data);
 					and_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xE7:
+			OP(0xE7):
 				rst_n(0x20);
-				break;
+				NEXT_OP;
 
 				// add sp,n (16 cycles):
 				// Add next (signed) byte in memory to SP, reset ZF and SF, check HCF and CF:
-			case 0xE8:
+			OP(0xE8):
 				sp_plus_n(sp);
 				cycleCounter += 4;
-				break;
+				NEXT_OP;
 
 				// jp hl (4 cycles):
 				// Jump to address in hl:
-			case 0xE9:
+			OP(0xE9):
 				pc = hl();
-				break;
+				NEXT_OP;
 
 				// ld (nn),a (16 cycles):
 				// set memory at address given by the next 2 bytes to value in A:
 				// Incrementing PC before call, because of possible interrupt.
-			case 0xEA:
+			OP(0xEA):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -1861,39 +2260,39 @@ void CPU::process(unsigned long const cycles) {
 					WRITE(immh << 8 | imml, a);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xEB: // not specified. should freeze.
-			case 0xEC: // not specified. should freeze.
-			case 0xED: // not specified. should freeze.
+			OP(0xEB): // not specified. should freeze.
+			OP(0xEC): // not specified. should freeze.
+			OP(0xED): // not specified. should freeze.
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
-			case 0xEE:
+			OP(0xEE):
 				{
 					unsigned data;
 					PC_READ(data);
 					xor_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xEF:
+			OP(0xEF):
 				rst_n(0x28);
-				break;
+				NEXT_OP;
 
 				// ld a,($FF00+n) (12 cycles):
 				// Put value at address (0xFF00 + next byte in memory) into A:
-			case 0xF0:
+			OP(0xF0):
 				{
 					unsigned imm;
 					PC_READ(imm);
 					FF_READ(a, imm);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xF1:
+			OP(0xF1):
 				{
 					unsigned F;
 					pop_rr(a, F);
@@ -1902,24 +2301,24 @@ void CPU::process(unsigned long const cycles) {
 					cf  =  cfFromF(F);
 				}
 
-				break;
+				NEXT_OP;
 
 				// ld a,($FF00+C) (8 cycles):
 				// Put value at address (0xFF00 + register C) into A:
-			case 0xF2:
+			OP(0xF2):
 				FF_READ(a, c);
-				break;
+				NEXT_OP;
 
 				// di (4 cycles):
-			case 0xF3:
+			OP(0xF3):
 				mem_.di();
-				break;
+				NEXT_OP;
 
-			case 0xF4: // not specified. should freeze.
+			OP(0xF4): // not specified. should freeze.
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
-			case 0xF5:
+			OP(0xF5):
 				hf2 = updateHf2FromHf1(hf1, hf2);
 
 				{
@@ -1927,24 +2326,24 @@ void CPU::process(unsigned long const cycles) {
 					push_rr(a, F);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xF6:
+			OP(0xF6):
 				{
 					unsigned data;
 					PC_READ(data);
 					or_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xF7:
+			OP(0xF7):
 				rst_n(0x30);
-				break;
+				NEXT_OP;
 
 				// ldhl sp,n (12 cycles):
 				// Put (sp+next (signed) byte in memory) into hl (unsets ZF and SF, may enable HF and CF):
-			case 0xF8:
+			OP(0xF8):
 				{
 					unsigned sum;
 					sp_plus_n(sum);
@@ -1952,18 +2351,18 @@ void CPU::process(unsigned long const cycles) {
 					h = sum >> 8;
 				}
 
-				break;
+				NEXT_OP;
 
 				// ld sp,hl (8 cycles):
 				// Put value in HL into SP
-			case 0xF9:
+			OP(0xF9):
 				sp = hl();
 				cycleCounter += 4;
-				break;
+				NEXT_OP;
 
 				// ld a,(nn) (16 cycles):
 				// set A to value in memory at address given by the 2 next bytes.
-			case 0xFA:
+			OP(0xFA):
 				{
 					unsigned imml, immh;
 					PC_READ(imml);
@@ -1972,20 +2371,20 @@ void CPU::process(unsigned long const cycles) {
 					READ(a, immh << 8 | imml);
 				}
 
-				break;
+				NEXT_OP;
 
 				// ei (4 cycles):
 				// Enable Interrupts after next instruction:
-			case 0xFB:
+			OP(0xFB):
 				mem_.ei(cycleCounter);
-				break;
+				NEXT_OP;
 
-			case 0xFC: // not specified. should freeze.
-			case 0xFD: // not specified. should freeze
+			OP(0xFC): // not specified. should freeze.
+			OP(0xFD): // not specified. should freeze
 				cycleCounter = freeze(mem_, cycleCounter);
-				break;
+				NEXT_OP;
 
-			case 0xFE:
+			OP(0xFE):
 				{
 					unsigned data;
 					PC_READ(data);
@@ -1993,20 +2392,92 @@ void CPU::process(unsigned long const cycles) {
 					cp_a_u8(data);
 				}
 
-				break;
+				NEXT_OP;
 
-			case 0xFF:
+			OP(0xFF):
 				rst_n(0x38);
-				break;
+				NEXT_OP;
+			}
+
+			// run a fused inc/dec rr right away as long as it would have been the
+			// next thing executed anyway.
+			if (cached && fuse && cycleCounter < mem_.nextEventTime()
+					&& mem_.rmem(pc >> 12) == oppage
+					&& (BlockCache::isRom(pc) || BlockCache::matches(*op, oppage))) {
+				pc = (pc + 1) & 0xFFFF;
+				cycleCounter += 4;
+				++ops;
+
+				switch ((op++)->opcode) {
+				case 0x03: inc_rr(b, c); break;
+				case 0x0B: dec_rr(b, c); break;
+				case 0x13: inc_rr(d, e); break;
+				case 0x1B: dec_rr(d, e); break;
+				case 0x23: inc_rr(h, l); break;
+				case 0x2B: dec_rr(h, l); break;
+				case 0x33:
+					sp = (sp + 1) & 0xFFFF;
+					cycleCounter += 4;
+					break;
+				case 0x3B:
+					sp = (sp - 1) & 0xFFFF;
+					cycleCounter += 4;
+					break;
+				}
+			}
+
+			if (cached && verifyEnd && op == verifyEnd) {
+				JitRegs regs;
+				getJitRegs(regs, a);
+				if (pc != verifyPc || cycleCounter != verifyCycles || !sameJitRegs(regs, verifyRegs)) {
+					++jitMismatches_;
+					verifyBlock->native = 0;
+					verifyBlock->hits = 0xFFFF;
+				}
+
+				verifyEnd = 0;
+			}
+
+			// a loop that comes back around to the same state without any side effects
+			// will keep doing so until something else happens, which can only be at
+			// the next event (or when LY changes). skip all of the whole iterations
+			// before then. loops listed in the speed hack database get the same checks,
+			// but need not come back to the same a and F.
+			if (pc <= oppc) {
+				if (idle.valid && idle.pc == pc && cycleCounter < mem_.nextEventTime()) {
+					unsigned long end = cycleCounter;
+					if ((idle.a == a && idle.hf1 == hf1 && idle.hf2 == hf2
+							&& idle.zf == zf && idle.cf == cf)
+							|| (!idleLoopHints_.empty() && isIdleLoopHint(pc))) {
+						end = idleLoopEnd(pc, oppc, idle.cc, cycleCounter);
+					}
+
+					unsigned long const period = cycleCounter - idle.cc;
+					unsigned long const skip = (end - cycleCounter) / period * period;
+					cycleCounter += skip;
+					idleCycles_ += skip;
+				}
+
+				idle.cc = cycleCounter;
+				idle.hf1 = hf1;
+				idle.hf2 = hf2;
+				idle.zf = zf;
+				idle.cf = cf;
+				idle.pc = pc;
+				idle.a = a;
+				idle.valid = true;
 			}
 		}
 
+		idle.valid = false;
 		pc_ = pc;
+		PROFILE_EVENT();
 		cycleCounter = mem_.event(cycleCounter);
 	}
 
 	a_ = a;
 	cycleCounter_ = cycleCounter;
+	instructions_ += ops;
 }
 
 }
@@ -19,7 +19,12 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include "blockcache.h"
+#include "jit.h"
 #include "memory.h"
+#include "profiler.h"
+#include "trace.h"
+#include <vector>
 
 namespace gambatte {
 
@@ -32,6 +37,10 @@ public:
 	void setStatePtrs(SaveState &state);
 	void saveState(SaveState &state);
 	void loadState(SaveState const &state);
+
+	// makes the state exactly that of cpu, which must have the same ROM loaded, after a
+	// load of a state saved from cpu at its current time.
+	void copyState(CPU const &cpu);
 	void loadSavedata() { mem_.loadSavedata(); }
 	void saveSavedata() { mem_.saveSavedata(); }
 
@@ -56,14 +65,41 @@ public:
 	}
 
 	LoadRes load(File &file, std::string const &filename, bool forceDmg, bool multicartCompat) {
+		invalidateBlocks();
 		return mem_.loadROM(file, filename, forceDmg, multicartCompat);
 	}
 
+	LoadRes load(CPU const &parent, bool forceDmg, bool multicartCompat) {
+		invalidateBlocks();
+		return mem_.loadROM(parent.mem_, forceDmg, multicartCompat);
+	}
+
+	void setBlockCacheEnabled(bool enable);
+	bool blockCacheEnabled() const { return blockCache_.enabled(); }
+	bool setJitMode(Jit::Mode mode);
+	Jit::Mode jitMode() const { return jit_.mode(); }
+	unsigned long jitMismatches() const { return jitMismatches_; }
+	void setIdleLoopHints(std::vector<unsigned long> const &romOffsets) { idleLoopHints_ = romOffsets; }
+	unsigned long idleCyclesLastFrame() const { return idleCyclesLastFrame_; }
+	unsigned long cycleCount() const { return mem_.cycleCount(cycleCounter_); }
+	void setCycleCount(unsigned long count) { mem_.setCycleCount(cycleCounter_, count); }
+	void setEventListener(EventListener *listener) { mem_.setEventListener(listener); }
+	bool startTimeline(std::string const &path) { return mem_.startTimeline(path); }
+	void stopTimeline() { mem_.stopTimeline(); }
+	unsigned long instructions() const { return instructions_; }
+	Memory const & mem() const { return mem_; }
+	bool setProfilerEnabled(bool enable);
+	Profiler const & profiler() const { return profiler_; }
+	void resetProfile() { profiler_.reset(); }
+	bool setTraceSize(std::size_t size);
+	Trace const & trace() const { return trace_; }
+
 	bool loaded() const { return mem_.loaded(); }
 	char const * romTitle() const { return mem_.romTitle(); }
 	PakInfo const pakInfo(bool multicartCompat) const { return mem_.pakInfo(multicartCompat); }
 	void setSoundBuffer(uint_least32_t *buf) { mem_.setSoundBuffer(buf); }
 	std::size_t fillSoundBuffer() { return mem_.fillSoundBuffer(cycleCounter_); }
+	void setAudioEnabled(bool enable) { mem_.setAudioEnabled(enable); }
 	bool isCgb() const { return mem_.isCgb(); }
 
 	void setCgbColorCorrection(int optNum) {
@@ -74,11 +110,46 @@ public:
 		mem_.setDmgPaletteColor(palNum, colorNum, rgb32);
 	}
 
-	void setGameGenie(std::string const &codes) { mem_.setGameGenie(codes); }
+	void setGameGenie(std::string const &codes) {
+		mem_.setGameGenie(codes);
+		invalidateBlocks();
+	}
+
 	void setGameShark(std::string const &codes) { mem_.setGameShark(codes); }
+	void setBreakpoint(unsigned bank, unsigned p, bool enable) { mem_.setBreakpoint(bank, p, enable); }
+	void setWatchpoint(unsigned p, unsigned flags) { mem_.setWatchpoint(p, flags); }
+	void clearBreakpoints() { mem_.clearBreakpoints(); }
+	bool hasBreakpoints() const { return mem_.hasBreakpoints(); }
+	bool hasWatchpoints() const { return mem_.hasWatchpoints(); }
+	unsigned char const * wram() const { return mem_.wram(); }
+	std::size_t wramSize() const { return mem_.wramSize(); }
+	unsigned wramBank() const { return mem_.wramBank(); }
+	unsigned char const * vram() const { return mem_.vram(); }
+	std::size_t vramSize() const { return mem_.vramSize(); }
+	unsigned vramBank() const { return mem_.vramBank(); }
+	unsigned char const * sram() const { return mem_.sram(); }
+	std::size_t sramSize() const { return mem_.sramSize(); }
+	int sramBank() const { return mem_.sramBank(); }
+	unsigned romBank() const { return mem_.romBank(0x4000); }
+	unsigned char const * oam() const { return mem_.oam(); }
+	unsigned char const * io() const { return mem_.io(); }
+	unsigned char const * hram() const { return mem_.hram(); }
+	bool lcdEnabled() const { return mem_.lcdEnabled(); }
+	BreakReason breakReason() const { return mem_.breakReason(); }
+	unsigned breakAddress() const { return mem_.breakAddress(); }
+	unsigned long breakCycles() const { return mem_.breakCycles(); }
 
 private:
 	Memory mem_;
+	BlockCache blockCache_;
+	Jit jit_;
+	unsigned long jitMismatches_;
+	Profiler profiler_;
+	Trace trace_;
+	std::vector<unsigned long> idleLoopHints_;
+	unsigned long idleCycles_;
+	unsigned long idleCyclesLastFrame_;
+	unsigned long instructions_;
 	unsigned long cycleCounter_;
 	unsigned short pc_;
 	unsigned short sp;
@@ -87,7 +158,14 @@ private:
 	unsigned char opcode_;
 	bool prefetched_;
 
-	void process(unsigned long cycles);
+	enum { max_idle_loop_size = 0x20 };
+
+	unsigned long idleLoopEnd(unsigned begin, unsigned end, unsigned long since, unsigned long cc);
+	bool isIdleLoopHint(unsigned pc) const;
+	void invalidateBlocks() { blockCache_.invalidate(); jit_.flush(); }
+	void getJitRegs(JitRegs &regs, unsigned char a) const;
+	unsigned char setJitRegs(JitRegs const &regs);
+	template <bool cached> void process(unsigned long cycles);
 };
 
 }
@@ -0,0 +1,50 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef GAMBATTE_EVENTLISTENER_H
+#define GAMBATTE_EVENTLISTENER_H
+
+namespace gambatte {
+
+/**
+  * Receives notifications of emulation events while GB runs. 'cycle' is the
+  * GB::cycleCount() value at which the event happened. The calls come from
+  * inside the emulation loop, so implementations must return quickly and must
+  * not call back into GB.
+  */
+class EventListener {
+public:
+	virtual ~EventListener() {}
+
+	/** Vertical blank has started (the LCD is on and has finished drawing a frame). */
+	virtual void vblank(unsigned long /*cycle*/) {}
+
+	/** A frame has been written to the video buffer. runFor returns right after. */
+	virtual void blit(unsigned long /*cycle*/) {}
+
+	/** A serial transfer has completed, leaving 'data' in SB. */
+	virtual void serialTransfer(unsigned long /*cycle*/, unsigned /*data*/) {}
+
+	/** The CPU has executed STOP. */
+	virtual void stop(unsigned long /*cycle*/) {}
+
+	/** The CPU has executed an undefined opcode and is frozen for good. */
+	virtual void freeze(unsigned long /*cycle*/) {}
+};
+
+}
+
+#endif
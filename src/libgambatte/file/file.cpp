@@ -20,7 +20,25 @@ Free Software Foundation, Inc.,
 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
 ***************************************************************************/
 #include "stdfile.h"
+#ifndef _WIN32
+#include "mmapfile.h"
+#endif
+
+transfer_ptr<gambatte::File> gambatte::newFileInstance(std::string const &filepath, bool const mapped) {
+#ifndef _WIN32
+	if (mapped) {
+		transfer_ptr<File> file(new MmapFile(filepath.c_str()));
+		if (!file->fail())
+			return file;
+	}
+#endif
 
-transfer_ptr<gambatte::File> gambatte::newFileInstance(std::string const &filepath) {
 	return transfer_ptr<File>(new StdFile(filepath.c_str()));
 }
+
+void gambatte::unmapFile(unsigned char const *const mapping, std::size_t const size) {
+#ifndef _WIN32
+	if (mapping)
+		munmap(const_cast<unsigned char *>(mapping), size);
+#endif
+}
@@ -34,9 +34,22 @@ public:
 	virtual std::size_t size() const = 0;
 	virtual void read(char *buffer, std::size_t amount) = 0;
 	virtual bool fail() const = 0;
+
+	/**
+	  * Returns the whole contents if the file keeps them mapped read-only in memory,
+	  * or else 0.
+	  */
+	virtual unsigned char const * mapping() const { return 0; }
+
+	/**
+	  * Hands the mapping over to the caller, who frees it with unmapFile once done.
+	  * The file must not be read from afterwards.
+	  */
+	virtual void releaseMapping() {}
 };
 
-transfer_ptr<File> newFileInstance(std::string const &filepath);
+transfer_ptr<File> newFileInstance(std::string const &filepath, bool mapped = true);
+void unmapFile(unsigned char const *mapping, std::size_t size);
 
 }
 
@@ -0,0 +1,81 @@
+/***************************************************************************
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License version 2 for more details.
+
+You should have received a copy of the GNU General Public License
+version 2 along with this program; if not, write to the
+Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+***************************************************************************/
+#ifndef GAMBATTE_MMAP_FILE_H
+#define GAMBATTE_MMAP_FILE_H
+
+#include "file.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gambatte {
+
+// Maps the whole file read-only rather than reading it through a stream, so that
+// the ROM image can be used in place. Like any mapping, it sees changes made to
+// the file on disk while mapped.
+class MmapFile : public File {
+public:
+	explicit MmapFile(char const *filename)
+	: data_(0)
+	, fsize_(0)
+	, offset_(0)
+	, fail_(true)
+	{
+		int const fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *const p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				data_ = static_cast<unsigned char const *>(p);
+				fsize_ = st.st_size;
+				fail_ = false;
+			}
+		}
+
+		close(fd);
+	}
+
+	virtual ~MmapFile() { unmapFile(data_, fsize_); }
+	virtual void rewind() { offset_ = 0; }
+	virtual std::size_t size() const { return fsize_; }
+
+	virtual void read(char *buffer, std::size_t amount) {
+		std::size_t const n = std::min(amount, fsize_ - offset_);
+		std::memcpy(buffer, data_ + offset_, n);
+		offset_ += n;
+		fail_ |= n < amount;
+	}
+
+	virtual bool fail() const { return fail_; }
+	virtual unsigned char const * mapping() const { return data_; }
+	virtual void releaseMapping() { data_ = 0; }
+
+private:
+	unsigned char const *data_;
+	std::size_t fsize_;
+	std::size_t offset_;
+	bool fail_;
+};
+
+}
+
+#endif
@@ -19,12 +19,18 @@
 #include "file/file.h"
 #include "file/memfile.h"
 #include "gambatte.h"
+#include "array.h"
+#include "eventlistener.h"
 #include "cpu.h"
 #include "initstate.h"
 #include "savestate.h"
+#include "speedhacks.h"
 #include "state_osd_elements.h"
 #include "statesaver.h"
+#include "statesnapshot.h"
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
 #include <sstream>
 
@@ -32,6 +38,11 @@ using namespace gambatte;
 
 namespace {
 
+enum { samples_per_frame = 35112, max_overrun_samples = 2064 };
+
+// the most frame lengths GB::Priv::runFrame runs in one frame. see there.
+enum { max_frame_chunks = 4 };
+
 std::string to_string(int i) {
 	std::stringstream ss;
 	ss << i;
@@ -42,21 +53,130 @@ std::string statePath(std::string const &basePath, int stateNo) {
 	return basePath + '_' + to_string(stateNo) + ".gqs";
 }
 
+GB::MemoryView makeMemoryView(unsigned char const *data, std::size_t size) {
+	GB::MemoryView const view = { data, size };
+	return view;
+}
+
+struct FixedInput : InputGetter {
+	unsigned buttons;
+
+	FixedInput() : buttons(0) {}
+	virtual unsigned operator()() { return buttons; }
+};
+
+// adds the counts from 'from' to 'to' to s.
+void addStatsDifference(GB::Stats &s, GB::Stats const &to, GB::Stats const &from) {
+	s.instructions += to.instructions - from.instructions;
+	s.cycles += to.cycles - from.cycles;
+	for (int i = 0; i < GB::STATS_EVENT_COUNT; ++i)
+		s.events[i] += to.events[i] - from.events[i];
+
+	s.lcdEvents += to.lcdEvents - from.lcdEvents;
+	s.ppuUpdates += to.ppuUpdates - from.ppuUpdates;
+	s.nontrivialReads += to.nontrivialReads - from.nontrivialReads;
+	s.nontrivialWrites += to.nontrivialWrites - from.nontrivialWrites;
+	s.samples += to.samples - from.samples;
+}
+
 }
 
 struct GB::Priv {
 	CPU cpu;
+	SpeedHackDb speedHacks;
+	StateSnapshot snapshot;
+	Stats statsBase;
+	Array<gambatte::uint_least32_t> stepVideo;
+	FixedInput stepInput;
+	InputGetter *inputGetter;
+	EventListener *eventListener;
 	int stateNo;
 	unsigned loadflags;
+	unsigned runAhead;
+	bool audioEnabled;
+	bool forked;
 
-	Priv() : stateNo(1), loadflags(0) {}
+	void applySpeedHacks() {
+		PakInfo const &pak = cpu.pakInfo(loadflags & MULTICART_COMPAT);
+		cpu.setIdleLoopHints(speedHacks.idleLoops(pak.headerChecksum(), pak.globalChecksum()));
+	}
+
+	// save data written implicitly, on ROM close, reset and state loads. A fork skips
+	// these, so that a branch cannot overwrite the battery save of its parent.
+	void implicitSave() {
+		if (cpu.loaded() && !forked)
+			cpu.saveSavedata();
+	}
+
+	long runFrame();
+	void runAheadFrames(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch);
+	Stats totals() const;
+
+	Priv() : statsBase(), inputGetter(0), eventListener(0), stateNo(1), loadflags(0), runAhead(0), audioEnabled(true), forked(false) {}
 };
 
+// runs until the next frame is blitted, and returns the cycles since, or -1 after a
+// break. the next blit is less than two frame lengths away after the LCD is turned
+// on or off, and blank frames are blitted while it stays off. a frame ends without
+// a blit only when the LCD is still off after three frame lengths, or after
+// max_frame_chunks if a game keeps turning it back on before it blits.
+long GB::Priv::runFrame() {
+	for (int chunk = 1;; ++chunk) {
+		long const csb = cpu.runFor(samples_per_frame * 2);
+		if (csb >= 0 || cpu.breakReason() != break_none)
+			return csb;
+
+		if ((chunk >= 3 && !cpu.lcdEnabled()) || chunk == max_frame_chunks)
+			return -1;
+	}
+}
+
+void GB::Priv::runAheadFrames(gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch) {
+	snapshot.save(cpu);
+	Stats const before = totals();
+	cpu.setAudioEnabled(false);
+	cpu.setEventListener(0);
+
+	for (unsigned frame = 0; frame < runAhead; ++frame) {
+		cpu.setVideoBuffer(frame == runAhead - 1 ? videoBuf : 0, pitch);
+		runFrame();
+	}
+
+	snapshot.load(cpu);
+	cpu.setAudioEnabled(audioEnabled);
+	cpu.setEventListener(eventListener);
+
+	// the snapshot only rolls back counters that are part of the state, like cycles.
+	// the others are rebased, so that stats leaves the discarded frames out.
+	addStatsDifference(statsBase, totals(), before);
+}
+
+GB::Stats GB::Priv::totals() const {
+	Memory const &mem = cpu.mem();
+	Stats s;
+	s.instructions = cpu.instructions();
+	s.cycles = cpu.cycleCount();
+	s.events[STATS_EVENT_UNHALT] = mem.eventCount(intevent_unhalt);
+	s.events[STATS_EVENT_END] = mem.eventCount(intevent_end);
+	s.events[STATS_EVENT_BLIT] = mem.eventCount(intevent_blit);
+	s.events[STATS_EVENT_SERIAL] = mem.eventCount(intevent_serial);
+	s.events[STATS_EVENT_OAM] = mem.eventCount(intevent_oam);
+	s.events[STATS_EVENT_DMA] = mem.eventCount(intevent_dma);
+	s.events[STATS_EVENT_TIMA] = mem.eventCount(intevent_tima);
+	s.events[STATS_EVENT_VIDEO] = mem.eventCount(intevent_video);
+	s.events[STATS_EVENT_INTERRUPTS] = mem.eventCount(intevent_interrupts);
+	s.lcdEvents = mem.lcdEventCount();
+	s.ppuUpdates = mem.ppuUpdateCount();
+	s.nontrivialReads = mem.nontrivialReads();
+	s.nontrivialWrites = mem.nontrivialWrites();
+	s.samples = mem.sampleCount();
+	return s;
+}
+
 GB::GB() : p_(new Priv) {}
 
 GB::~GB() {
-	if (p_->cpu.loaded())
-		p_->cpu.saveSavedata();
+	p_->implicitSave();
 
 	delete p_;
 }
@@ -78,22 +198,294 @@ std::ptrdiff_t GB::runFor(gambatte::uint_least32_t *const videoBuf, std::ptrdiff
 	     : cyclesSinceBlit;
 }
 
+std::ptrdiff_t GB::runFrames(unsigned const frames,
+                             gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+                             std::ptrdiff_t const frameStride,
+                             gambatte::uint_least32_t *const soundBuf, std::size_t &samples) {
+	if (!p_->cpu.loaded() || !frames) {
+		samples = 0;
+		return -1;
+	}
+
+	p_->cpu.setSoundBuffer(soundBuf);
+
+	bool const ahead = p_->runAhead && !p_->cpu.hasBreakpoints() && !p_->cpu.hasWatchpoints();
+	long cyclesSinceBlit = -1;
+	for (unsigned frame = 0; frame < frames; ++frame) {
+		if (frame == 0 || frameStride || frame == frames - 1) {
+			p_->cpu.setVideoBuffer(videoBuf && !ahead && (frameStride || frame == frames - 1)
+				? videoBuf + std::ptrdiff_t(frame) * frameStride
+				: 0, pitch);
+		}
+
+		cyclesSinceBlit = p_->runFrame();
+		if (p_->cpu.breakReason() != break_none)
+			break;
+	}
+
+	samples = p_->cpu.fillSoundBuffer();
+	if (ahead && videoBuf && p_->cpu.breakReason() == break_none)
+		p_->runAheadFrames(videoBuf + std::ptrdiff_t(frames - 1) * frameStride, pitch);
+
+	return cyclesSinceBlit >= 0
+	     ? static_cast<std::ptrdiff_t>(samples) - (cyclesSinceBlit >> 1)
+	     : cyclesSinceBlit;
+}
+
+std::size_t GB::runFramesAudioSize(unsigned const frames) {
+	return std::size_t(frames) * max_frame_chunks * (samples_per_frame + max_overrun_samples);
+}
+
+unsigned long GB::cycleCount() const {
+	return p_->cpu.cycleCount();
+}
+
+unsigned long GB::runCycles(unsigned long const cycles,
+                            gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+                            gambatte::uint_least32_t *const soundBuf, std::size_t &samples) {
+	if (!p_->cpu.loaded()) {
+		samples = 0;
+		return 0;
+	}
+
+	p_->cpu.setVideoBuffer(videoBuf, pitch);
+	p_->cpu.setSoundBuffer(soundBuf);
+
+	// runFor returns at every blit, and the end time is set through
+	// setEndtime, so budgets are handed out no more than a frame at a time.
+	unsigned long const start = p_->cpu.cycleCount();
+	unsigned long done = 0;
+	while (done < cycles) {
+		p_->cpu.runFor(std::min(cycles - done, static_cast<unsigned long>(samples_per_frame * 2)));
+		done = p_->cpu.cycleCount() - start;
+		if (p_->cpu.breakReason() != break_none)
+			break;
+	}
+
+	samples = p_->cpu.fillSoundBuffer();
+	return done;
+}
+
+unsigned long GB::runUntil(unsigned long const cycle,
+                           gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+                           gambatte::uint_least32_t *const soundBuf, std::size_t &samples) {
+	unsigned long const remaining = cycle - p_->cpu.cycleCount();
+	runCycles(remaining <= ULONG_MAX / 2 ? remaining : 0, videoBuf, pitch, soundBuf, samples);
+	return p_->cpu.cycleCount();
+}
+
+void GB::setAudioEnabled(bool enable) {
+	p_->audioEnabled = enable;
+	p_->cpu.setAudioEnabled(enable);
+}
+
+void GB::setRunAhead(unsigned frames) {
+	p_->runAhead = frames;
+}
+
+GB::StepResult GB::step(unsigned const buttons, unsigned const frameRepeat,
+                        ObservationMode const observationMode) {
+	StepResult result = StepResult();
+	if (!p_->cpu.loaded())
+		return result;
+
+	gambatte::uint_least32_t *video = 0;
+	if (observationMode == OBSERVE_VIDEO) {
+		if (!p_->stepVideo.get())
+			p_->stepVideo.reset(160 * 144);
+
+		video = p_->stepVideo;
+	}
+
+	p_->stepInput.buttons = buttons;
+	p_->cpu.setInputGetter(&p_->stepInput);
+	p_->cpu.setAudioEnabled(false);
+	p_->cpu.setSoundBuffer(0);
+
+	long cyclesSinceBlit = -1;
+	while (result.frames < frameRepeat) {
+		p_->cpu.setVideoBuffer(result.frames == frameRepeat - 1 ? video : 0, 160);
+		cyclesSinceBlit = p_->runFrame();
+		if (p_->cpu.breakReason() != break_none)
+			break;
+
+		++result.frames;
+	}
+
+	p_->cpu.setAudioEnabled(p_->audioEnabled);
+	p_->cpu.setInputGetter(p_->inputGetter);
+
+	result.video = result.frames == frameRepeat && cyclesSinceBlit >= 0 ? video : 0;
+	result.wram = p_->cpu.wram();
+	result.wramSize = p_->cpu.wramSize();
+	result.hram = p_->cpu.hram();
+	return result;
+}
+
+GB::Stats GB::stats() const {
+	Stats s = Stats();
+	addStatsDifference(s, p_->totals(), p_->statsBase);
+	return s;
+}
+
+void GB::resetStats() {
+	p_->statsBase = p_->totals();
+}
+
+GB::MemoryView GB::memoryView(MemoryArea const area) const {
+	if (p_->cpu.loaded()) {
+		switch (area) {
+		case MEM_WRAM:
+			return makeMemoryView(p_->cpu.wram(), p_->cpu.wramSize());
+		case MEM_VRAM:
+			return makeMemoryView(p_->cpu.vram(), p_->cpu.vramSize());
+		case MEM_OAM:
+			return makeMemoryView(p_->cpu.oam(), 0xA0);
+		case MEM_HRAM:
+			return makeMemoryView(p_->cpu.hram(), 0x7F);
+		case MEM_SRAM:
+			return makeMemoryView(p_->cpu.sram(), p_->cpu.sramSize());
+		case MEM_IO:
+			return makeMemoryView(p_->cpu.io(), 0x100);
+		}
+	}
+
+	return MemoryView();
+}
+
+GB::MemoryBanks GB::memoryBanks() const {
+	MemoryBanks banks = MemoryBanks();
+	if (p_->cpu.loaded()) {
+		banks.rom = p_->cpu.romBank();
+		banks.vram = p_->cpu.vramBank();
+		banks.wram = p_->cpu.wramBank();
+		banks.sram = p_->cpu.sramBank();
+	}
+
+	return banks;
+}
+
 void GB::reset() {
 	if (p_->cpu.loaded()) {
-		p_->cpu.saveSavedata();
+		p_->implicitSave();
 
-		SaveState state;
+		SaveState state = SaveState();
 		p_->cpu.setStatePtrs(state);
 		setInitState(state, p_->cpu.isCgb(), p_->loadflags & GBA_CGB);
 		p_->cpu.loadState(state);
-		p_->cpu.loadSavedata();
+		if (!p_->forked)
+			p_->cpu.loadSavedata();
+	}
+}
+
+void GB::setBlockCacheEnabled(bool enable) {
+	p_->cpu.setBlockCacheEnabled(enable);
+}
+
+bool GB::setJitMode(JitMode mode) {
+	return p_->cpu.setJitMode(mode == JIT_ON
+		? Jit::mode_on
+		: (mode == JIT_VERIFY ? Jit::mode_verify : Jit::mode_off));
+}
+
+unsigned long GB::jitMismatches() const {
+	return p_->cpu.jitMismatches();
+}
+
+bool GB::setSpeedHackDatabase(std::string const &db, std::string *error) {
+	if (!p_->speedHacks.parse(db, error))
+		return false;
+
+	if (p_->cpu.loaded())
+		p_->applySpeedHacks();
+
+	return true;
+}
+
+bool GB::checkSpeedHackDatabase(std::string const &db, std::string *error) {
+	SpeedHackDb speedHacks;
+	return speedHacks.parse(db, error);
+}
+
+unsigned long GB::idleCyclesLastFrame() const {
+	return p_->cpu.idleCyclesLastFrame();
+}
+
+bool GB::setProfilerEnabled(bool enable) {
+	return p_->cpu.setProfilerEnabled(enable);
+}
+
+void GB::resetProfile() {
+	p_->cpu.resetProfile();
+}
+
+void GB::writeProfile(std::ostream &stream) const {
+	p_->cpu.profiler().write(stream);
+}
+
+std::string const GB::profileReport(std::size_t topN) const {
+	return p_->cpu.profiler().report(topN);
+}
+
+bool GB::setTraceSize(std::size_t size) {
+	return p_->cpu.setTraceSize(size);
+}
+
+void GB::writeTrace(std::ostream &stream) const {
+	p_->cpu.trace().write(stream);
+}
+
+bool GB::startTimeline(std::string const &path) {
+	return p_->cpu.startTimeline(path);
+}
+
+void GB::stopTimeline() {
+	p_->cpu.stopTimeline();
+}
+
+void GB::setBreakpoint(unsigned bank, unsigned address, bool enable) {
+	p_->cpu.setBreakpoint(bank, address, enable);
+}
+
+void GB::setWatchpoint(unsigned address, unsigned flags) {
+	p_->cpu.setWatchpoint(address,
+		(flags & WATCH_READ ? Breakpoints::watch_read : 0)
+		| (flags & WATCH_WRITE ? Breakpoints::watch_write : 0));
+}
+
+void GB::clearBreakpoints() {
+	p_->cpu.clearBreakpoints();
+}
+
+GB::BreakReason GB::breakReason() const {
+	switch (p_->cpu.breakReason()) {
+	case break_pc: return BREAK_PC;
+	case break_read: return BREAK_READ;
+	case break_write: return BREAK_WRITE;
+	case break_none: break;
 	}
+
+	return BREAK_NONE;
+}
+
+unsigned GB::breakAddress() const {
+	return p_->cpu.breakAddress();
+}
+
+unsigned long GB::breakCycles() const {
+	return p_->cpu.breakCycles();
 }
 
 void GB::setInputGetter(InputGetter *getInput) {
+	p_->inputGetter = getInput;
 	p_->cpu.setInputGetter(getInput);
 }
 
+void GB::setEventListener(EventListener *listener) {
+	p_->eventListener = listener;
+	p_->cpu.setEventListener(listener);
+}
+
 void GB::setSaveDir(std::string const &sdir) {
 	p_->cpu.setSaveDir(sdir);
 }
@@ -107,32 +499,66 @@ LoadRes GB::load(const void *rom,
 }
 
 LoadRes GB::load(std::string const &filename, unsigned const flags) {
-	transfer_ptr<File> file = newFileInstance(filename);
+	transfer_ptr<File> file = newFileInstance(filename, !(flags & COPY_ROM));
 	return load(*file, filename, flags);
 }
 
 LoadRes GB::load(File &file, std::string const &filename, unsigned const flags) {
-	if (p_->cpu.loaded())
-		p_->cpu.saveSavedata();
+	p_->implicitSave();
 
 	LoadRes const loadres = p_->cpu.load(file, filename,
 	                                     flags & FORCE_DMG,
 	                                     flags & MULTICART_COMPAT);
 	if (loadres == LOADRES_OK) {
-		SaveState state;
+		SaveState state = SaveState();
 		p_->cpu.setStatePtrs(state);
 		p_->loadflags = flags;
 		setInitState(state, p_->cpu.isCgb(), flags & GBA_CGB);
 		p_->cpu.loadState(state);
+		p_->cpu.setCycleCount(0);
+		p_->statsBase = p_->totals();
 		p_->cpu.loadSavedata();
+		p_->applySpeedHacks();
 
 		p_->stateNo = 1;
+		p_->forked = false;
 		p_->cpu.setOsdElement(transfer_ptr<OsdElement>());
 	}
 
 	return loadres;
 }
 
+GB * GB::fork() {
+	if (!p_->cpu.loaded())
+		return 0;
+
+	GB *const gb = new GB;
+	Priv &child = *gb->p_;
+	if (child.cpu.load(p_->cpu, p_->loadflags & FORCE_DMG, p_->loadflags & MULTICART_COMPAT)) {
+		delete gb;
+		return 0;
+	}
+
+	child.speedHacks = p_->speedHacks;
+	child.inputGetter = p_->inputGetter;
+	child.stateNo = p_->stateNo;
+	child.loadflags = p_->loadflags;
+	child.runAhead = p_->runAhead;
+	child.audioEnabled = p_->audioEnabled;
+	child.forked = true;
+	child.cpu.setInputGetter(child.inputGetter);
+	child.cpu.setAudioEnabled(child.audioEnabled);
+	child.cpu.setBlockCacheEnabled(p_->cpu.blockCacheEnabled());
+	child.cpu.setJitMode(p_->cpu.jitMode());
+	child.applySpeedHacks();
+
+	child.snapshot.save(p_->cpu);
+	child.snapshot.load(child.cpu);
+	child.cpu.copyState(p_->cpu);
+	child.statsBase = child.totals();
+	return gb;
+}
+
 bool GB::isCgb() const {
 	return p_->cpu.isCgb();
 }
@@ -157,7 +583,7 @@ void GB::setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32) {
 //> OpenEmu
 bool GB::serializeState(std::ostream &stream) {
     if (p_->cpu.loaded()) {
-        SaveState state;
+        SaveState state = SaveState();
         p_->cpu.setStatePtrs(state);
         p_->cpu.saveState(state);
         return StateSaver::serializeState(state, stream);
@@ -168,9 +594,9 @@ bool GB::serializeState(std::ostream &stream) {
 
 bool GB::deserializeState(std::istream &stream) {
     if (p_->cpu.loaded()) {
-        p_->cpu.saveSavedata();
+        p_->implicitSave();
 
-        SaveState state;
+        SaveState state = SaveState();
         p_->cpu.setStatePtrs(state);
 
         if (StateSaver::deserializeState(state, stream)) {
@@ -185,7 +611,7 @@ bool GB::deserializeState(std::istream &stream) {
 //< OpenEmu
 bool GB::loadState(std::string const &filepath) {
 	if (p_->cpu.loaded()) {
-		p_->cpu.saveSavedata();
+		p_->implicitSave();
 
 		SaveState state = SaveState();
 		p_->cpu.setStatePtrs(state);
@@ -220,7 +646,7 @@ bool GB::loadState() {
 bool GB::saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
                    std::string const &filepath) {
 	if (p_->cpu.loaded()) {
-		SaveState state;
+		SaveState state = SaveState();
 		p_->cpu.setStatePtrs(state);
 		p_->cpu.saveState(state);
 		return StateSaver::saveState(state, videoBuf, pitch, filepath);
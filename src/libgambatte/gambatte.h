@@ -19,6 +19,7 @@
 #ifndef GAMBATTE_H
 #define GAMBATTE_H
 
+#include "eventlistener.h"
 #include "gbint.h"
 #include "inputgetter.h"
 #include "loadres.h"
@@ -40,13 +41,21 @@ public:
 		FORCE_DMG        = 1, /**< Treat the ROM as not having CGB support regardless of
 		                           what its header advertises. */
 		GBA_CGB          = 2, /**< Use GBA intial CPU register values when in CGB mode. */
-		MULTICART_COMPAT = 4  /**< Use heuristics to detect and support some multicart
+		MULTICART_COMPAT = 4, /**< Use heuristics to detect and support some multicart
 		                           MBCs disguised as MBC1. */
+		COPY_ROM         = 8  /**< Read the ROM file into memory rather than mapping it. */
 	};
 
 	 /*
 	  * Load ROM image.
 	  *
+	  * Where the platform allows it, and the file size is a power of two number of
+	  * 16 KiB banks, the file is mapped read-only and used in place rather than copied.
+	  * Truncating or rewriting the file while it is loaded (by a homebrew rebuild, say)
+	  * then changes the code under the running game or crashes the process with
+	  * SIGBUS. Pass COPY_ROM when the file may change. Mapped images are not shared
+	  * with other instances loading the same contents, except for forks.
+	  *
 	  * @param romfile  Path to rom image file. Typically a .gbc, .gb, or .zip-file (if
 	  *                 zip-support is compiled in).
 	  * @param flags    ORed combination of LoadFlags.
@@ -81,13 +90,16 @@ public:
 	  *
 	  * Returns early when a new video frame has finished drawing in the video buffer,
 	  * such that the caller may update the video output before the frame is overwritten.
+	  * Also returns early when a breakpoint or watchpoint is hit, see breakReason.
 	  * The return value indicates whether a new video frame has been drawn, and the
 	  * exact time (in number of samples) at which it was completed.
 	  *
-	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0. With 0 no
+	  *                 pixels are produced at all, which is cheaper. Emulation (timing,
+	  *                 LY/STAT, saved states) is the same either way.
 	  * @param pitch distance in number of pixels (not bytes) from the start of one line
 	  *              to the next in videoBuf.
-	  * @param audioBuf buffer with space >= samples + 2064
+	  * @param audioBuf buffer with space >= samples + 2064, or 0 while audio is disabled
 	  * @param samples  in: number of stereo samples to produce,
 	  *                out: actual number of samples produced
 	  * @return sample offset in audioBuf at which the video frame was completed, or -1
@@ -96,6 +108,203 @@ public:
 	std::ptrdiff_t runFor(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
 	                      gambatte::uint_least32_t *audioBuf, std::size_t &samples);
 
+	/**
+	  * Emulates 'frames' video frames in one call, where a frame ends when one has
+	  * finished drawing, as runFor reports it. A frame can take longer than 35112
+	  * samples: after the LCD is turned on or off, the next one is drawn up to two frame
+	  * lengths later. While the LCD is off, blank frames are drawn at the usual rate. A
+	  * frame only ends without being drawn if the LCD is still off after three frame
+	  * lengths, or after four if it keeps being turned back on before a frame is drawn.
+	  * Audio for all of them is appended to audioBuf, which must have room for
+	  * runFramesAudioSize(frames) samples.
+	  *
+	  * Returns early when a breakpoint or watchpoint is hit, see breakReason.
+	  *
+	  * With run-ahead on (see setRunAhead), the frames are emulated without being drawn,
+	  * and the last frame's place in videoBuf gets the frame that many frames ahead.
+	  *
+	  * @param videoBuf    160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param pitch       distance in number of pixels from the start of one line to
+	  *                    the next in videoBuf.
+	  * @param frameStride distance in number of pixels from the start of one frame to
+	  *                    the next in videoBuf, to have each frame drawn. If 0, only the
+	  *                    last frame is drawn.
+	  * @param audioBuf    buffer with space >= runFramesAudioSize(frames), or 0 while
+	  *                    audio is disabled
+	  * @param samples     out: number of stereo samples produced
+	  * @return sample offset in audioBuf at which the last video frame was completed,
+	  *         or -1 if the last frame did not finish drawing (see above, or a break).
+	  */
+	std::ptrdiff_t runFrames(unsigned frames,
+	                         gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
+	                         std::ptrdiff_t frameStride,
+	                         gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
+	/** Returns the number of samples audioBuf must have room for in runFrames. */
+	static std::size_t runFramesAudioSize(unsigned frames);
+
+	/**
+	  * Returns the number of cycles emulated since the ROM was loaded, counting 2 cycles
+	  * per audio sample in both CGB speed modes. It is not part of the savestate, and it
+	  * wraps around at ULONG_MAX, so compare values by their difference.
+	  */
+	unsigned long cycleCount() const;
+
+	/**
+	  * Emulates at least 'cycles' cycles (2 per audio sample) without returning at
+	  * completed video frames. Emulation stops at the first instruction boundary at or
+	  * after the target, so it may overshoot by a few cycles; the return value tells
+	  * exactly how many cycles were run. Frames finished along the way are drawn into
+	  * videoBuf. Returns early when a breakpoint or watchpoint is hit, see breakReason.
+	  *
+	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param pitch    distance in number of pixels from the start of one line to the
+	  *                 next in videoBuf.
+	  * @param audioBuf buffer with space >= cycles / 2 + 2064 samples, or 0 while audio
+	  *                 is disabled
+	  * @param samples  out: number of stereo samples produced
+	  * @return number of cycles emulated
+	  */
+	unsigned long runCycles(unsigned long cycles,
+	                        gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
+	                        gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
+	/**
+	  * Like runCycles, but runs until cycleCount() reaches 'cycle'. Does nothing if
+	  * 'cycle' has already been passed (it is at most ULONG_MAX / 2 behind).
+	  *
+	  * @return cycleCount() at which emulation stopped
+	  */
+	unsigned long runUntil(unsigned long cycle,
+	                       gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
+	                       gambatte::uint_least32_t *audioBuf, std::size_t &samples);
+
+	/**
+	  * Turns audio synthesis on or off. It is on by default. While it is off, runFor and
+	  * runFrames do not write to audioBuf, which may then be 0. They still report samples as
+	  * if they had been produced, so timing and return values stay the same. Sound
+	  * registers, NR52 status, length counters, envelopes, sweep and wave RAM access
+	  * behave exactly as with audio on.
+	  */
+	void setAudioEnabled(bool enable);
+
+	/**
+	  * Sets the number of frames runFrames runs ahead to cut input latency, 0 (the
+	  * default) to turn run-ahead off. After emulating its frames, runFrames keeps a
+	  * snapshot of the state in memory, emulates 'frames' more frames with the current
+	  * input, presents the video of the last one, and restores the snapshot. Audio is
+	  * still that of the frames that were kept, so that it plays back without gaps.
+	  * Run-ahead is skipped while breakpoints or watchpoints are set.
+	  */
+	void setRunAhead(unsigned frames);
+
+	enum ObservationMode {
+		OBSERVE_NONE, /**< Draw no frames. */
+		OBSERVE_VIDEO /**< Draw the last frame of each step. */
+	};
+
+	/** What step leaves to look at. The pointers stay valid until the next ROM load. */
+	struct StepResult {
+		/**
+		  * 160x144 RGB32 (native endian) last frame with a pitch of 160. 0 with
+		  * OBSERVE_NONE, after a break, or if the last frame ended without being drawn
+		  * (see runFrames).
+		  */
+		gambatte::uint_least32_t const *video;
+		/** Work RAM, 0xC000-0xDFFF followed by the other CGB banks. */
+		unsigned char const *wram;
+		std::size_t wramSize;
+		/** High RAM, 0xFF80-0xFFFE. */
+		unsigned char const *hram;
+		/** Number of frames emulated, less than frameRepeat after a break. */
+		unsigned frames;
+	};
+
+	/**
+	  * Emulates 'frameRepeat' video frames (as runFrames counts them) with 'buttons'
+	  * held, for driving the emulator as a reinforcement-learning environment. Only the
+	  * last frame is drawn, into a buffer owned by GB, and no audio is produced. The
+	  * InputGetter and audio setting are left as they were. Allocates nothing after the
+	  * first OBSERVE_VIDEO step.
+	  *
+	  * @param buttons ORed InputGetter::Button values
+	  */
+	StepResult step(unsigned buttons, unsigned frameRepeat, ObservationMode observationMode);
+
+	enum MemoryArea {
+		MEM_WRAM, /**< Work RAM, 0xC000-0xDFFF followed by the other CGB banks. */
+		MEM_VRAM, /**< Video RAM, bank 0 followed by bank 1 on CGB. */
+		MEM_OAM,  /**< Sprite attribute table, 0xFE00-0xFE9F. */
+		MEM_HRAM, /**< High RAM, 0xFF80-0xFFFE. */
+		MEM_SRAM, /**< Cartridge RAM, all banks. Empty if the cartridge has none. */
+		MEM_IO    /**< I/O page, 0xFF00-0xFFFF, including HRAM and IE. */
+	};
+
+	/** Read-only span of guest memory. */
+	struct MemoryView {
+		unsigned char const *data;
+		std::size_t size;
+	};
+
+	/**
+	  * Returns the backing store of a guest memory area without copying it. It keeps
+	  * pointing at live memory across runs and state loads, and is only invalidated by
+	  * loading a ROM. I/O registers whose value is computed when read (like LY, STAT,
+	  * DIV, TIMA and the sound status bits) may be out of date in MEM_IO.
+	  */
+	MemoryView memoryView(MemoryArea area) const;
+
+	/** Banks currently mapped into the CPU address space. */
+	struct MemoryBanks {
+		unsigned rom;  /**< ROM bank at 0x4000-0x7FFF. */
+		unsigned vram; /**< VRAM bank at 0x8000-0x9FFF. */
+		unsigned wram; /**< WRAM bank at 0xD000-0xDFFF. */
+		int sram;      /**< Cartridge RAM bank at 0xA000-0xBFFF, or -1 if it is disabled
+		                    or an RTC register is mapped there. */
+	};
+
+	MemoryBanks memoryBanks() const;
+
+	/** Kinds of scheduled events counted in Stats::events. */
+	enum StatsEvent {
+		STATS_EVENT_UNHALT,     /**< Leaving HALT. */
+		STATS_EVENT_END,        /**< End of a run. */
+		STATS_EVENT_BLIT,       /**< Frame completion. */
+		STATS_EVENT_SERIAL,     /**< Serial transfer completion. */
+		STATS_EVENT_OAM,        /**< OAM DMA progress. */
+		STATS_EVENT_DMA,        /**< General purpose and HBlank DMA. */
+		STATS_EVENT_TIMA,       /**< Timer overflow. */
+		STATS_EVENT_VIDEO,      /**< LCD interrupt and mode changes. */
+		STATS_EVENT_INTERRUPTS, /**< Interrupt dispatch. */
+		STATS_EVENT_COUNT
+	};
+
+	/**
+	  * Counts of work done by the emulator since the ROM was loaded or resetStats was
+	  * called. The counters are always kept; they wrap around at ULONG_MAX. Frames
+	  * emulated by run-ahead and then rolled back are not counted.
+	  */
+	struct Stats {
+		/** Instructions executed. Iterations of skipped idle loops are not counted. */
+		unsigned long instructions;
+		/** Cycles emulated, 2 per audio sample. */
+		unsigned long cycles;
+		/** Scheduled events handled, by StatsEvent. */
+		unsigned long events[STATS_EVENT_COUNT];
+		/** LCD events (mode, line and interrupt timing) handled. */
+		unsigned long lcdEvents;
+		/** Times the pixel pipeline was brought up to date. */
+		unsigned long ppuUpdates;
+		/** Memory reads and writes that took the slow path (I/O, DMA conflicts, banking). */
+		unsigned long nontrivialReads;
+		unsigned long nontrivialWrites;
+		/** Audio samples generated, whether or not audio output is enabled. */
+		unsigned long samples;
+	};
+
+	Stats stats() const;
+	void resetStats();
+
 	/**
 	  * Reset to initial state.
 	  * Equivalent to reloading a ROM image, or turning a Game Boy Color off and on again.
@@ -113,9 +322,164 @@ public:
 	  */
 	void setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32);
 
+	/**
+	  * Run guest code from a cache of pre-decoded straight-line blocks rather than
+	  * fetching and decoding every instruction. Emulated behavior is identical either
+	  * way. Disabled by default. May be changed at any time.
+	  */
+	void setBlockCacheEnabled(bool enable);
+
+	enum JitMode {
+		JIT_OFF,   /**< Interpret only. */
+		JIT_ON,    /**< Run hot cached blocks as native code. */
+		JIT_VERIFY /**< Run native code alongside the interpreter and compare results. */
+	};
+
+	/**
+	  * Selects whether hot blocks of ROM code are recompiled to native code. Enabling
+	  * the recompiler also enables the block cache, and disabling the block cache turns
+	  * it off again. In JIT_VERIFY mode emulation is driven by the interpreter, and any
+	  * native block whose resulting registers, pc or cycle count differ is counted and
+	  * dropped. May be changed at any time.
+	  *
+	  * @return false if the recompiler is not available on this platform.
+	  */
+	bool setJitMode(JitMode mode);
+
+	/** Returns the number of native blocks rejected in JIT_VERIFY mode so far. */
+	unsigned long jitMismatches() const;
+
+	/**
+	  * Sets the database of per-title speed hacks. See speedhacks.h for the format.
+	  * Hints matching the header and global checksums of the loaded ROM are applied
+	  * right away and on each subsequent load.
+	  *
+	  * @param error if not 0, set to a description of the problem when db is invalid.
+	  * @return false, leaving the current database in place, if db is invalid.
+	  */
+	bool setSpeedHackDatabase(std::string const &db, std::string *error = 0);
+
+	/**
+	  * Checks the syntax of a speed hack database without using it. Same result as
+	  * setSpeedHackDatabase. Whether an idle loop hint fits the code at its address
+	  * is only checked as the loop runs, see speedhacks.h.
+	  */
+	static bool checkSpeedHackDatabase(std::string const &db, std::string *error = 0);
+
+	/**
+	  * Number of CPU cycles skipped by idle loop fast-forwarding (both detected loops
+	  * and speed hack database hints) during the last completed video frame.
+	  */
+	unsigned long idleCyclesLastFrame() const;
+
+	/**
+	  * Turns the guest CPU profiler on or off. While on, the interpreter counts the
+	  * executions of each opcode and the executions and cycles spent at each
+	  * instruction address (per bank for ROM). The block cache and recompiler are
+	  * bypassed while it is on. The profile accumulates until resetProfile.
+	  *
+	  * @return false if enabling was asked for and the library was built without
+	  *         GAMBATTE_PROFILER.
+	  */
+	bool setProfilerEnabled(bool enable);
+
+	/** Clears the collected profile. */
+	void resetProfile();
+
+	/**
+	  * Writes the collected profile to stream in a flat big-endian binary format.
+	  * See profiler.h for the layout.
+	  */
+	void writeProfile(std::ostream &stream) const;
+
+	/** Returns a text report of the topN hottest addresses and most executed opcodes. */
+	std::string const profileReport(std::size_t topN) const;
+
+	/**
+	  * Sets how many of the last executed instructions are kept in the trace ring
+	  * buffer, rounded up to a power of two. Each takes 16 bytes, allocated here and
+	  * not while running. 0 turns tracing off. The block cache and recompiler are
+	  * bypassed while tracing.
+	  *
+	  * @return false if size is not 0 and the library was built without GAMBATTE_TRACE.
+	  */
+	bool setTraceSize(std::size_t size);
+
+	/**
+	  * Writes the traced instructions, oldest first, to stream. Meant to be called on
+	  * demand or from a host's watchdog or assertion handler to see what led up to a
+	  * desync. See trace.h for the format and src/tools/gbtrace.cpp for a decoder.
+	  */
+	void writeTrace(std::ostream &stream) const;
+
+	/**
+	  * Starts writing an emulated-timeline trace to the file at path, in the Chrome
+	  * trace event JSON format read by chrome://tracing and ui.perfetto.dev. It has a
+	  * span for each event dispatch, LCD event, interrupt dispatch and VRAM DMA
+	  * transfer, shown both on the emulated timeline (cycleCount) and on the host
+	  * one. A background thread writes the file. Frames emulated for run-ahead are
+	  * recorded too. A trace already being written is finished first.
+	  *
+	  * @return false if path could not be opened or the library was built without
+	  *         GAMBATTE_TIMELINE.
+	  */
+	bool startTimeline(std::string const &path);
+
+	/** Finishes the file started by startTimeline. Also done on destruction. */
+	void stopTimeline();
+
+	enum BreakReason {
+		BREAK_NONE,  /**< No breakpoint or watchpoint was hit. */
+		BREAK_PC,    /**< An instruction at a breakpoint was about to run. */
+		BREAK_READ,  /**< A watched address was read. */
+		BREAK_WRITE  /**< A watched address was written. */
+	};
+
+	enum WatchFlag { WATCH_READ = 1, WATCH_WRITE = 2 };
+
+	/**
+	  * Sets or clears a breakpoint. runFor returns right before the instruction at
+	  * 'address' runs, and resumes with it on the next call. For ROM addresses (below
+	  * 0x8000) the breakpoint only hits while ROM bank 'bank' is mapped there. 'bank'
+	  * is ignored for other addresses. The block cache and recompiler are bypassed
+	  * while any breakpoints are set. Breakpoints stay set across ROM loads.
+	  */
+	void setBreakpoint(unsigned bank, unsigned address, bool enable);
+
+	/**
+	  * Sets which accesses to 'address' make runFor return, as an ORed combination of
+	  * WatchFlags (0 clears the watchpoint). runFor returns after the instruction that
+	  * made the access. Opcode and operand fetches count as reads. HRAM (0xFF80-0xFFFE)
+	  * cannot be watched, IE (0xFFFF) can. The block cache and recompiler are bypassed
+	  * while any read watchpoints are set.
+	  */
+	void setWatchpoint(unsigned address, unsigned flags);
+
+	/** Clears all breakpoints and watchpoints. */
+	void clearBreakpoints();
+
+	/** Returns what made the last runFor call return early, or BREAK_NONE. */
+	BreakReason breakReason() const;
+
+	/** Address of the breakpoint or watched access that made the last runFor call return. */
+	unsigned breakAddress() const;
+
+	/**
+	  * Time of the breakpoint or watched access that made the last runFor call return,
+	  * in cycles (2 per audio sample) since the start of the call.
+	  */
+	unsigned long breakCycles() const;
+
 	/** Sets the callback used for getting input state. */
 	void setInputGetter(InputGetter *getInput);
 
+	/**
+	  * Sets the listener notified of vblank, blit, serial transfer, STOP and freeze
+	  * events as they are emulated, or 0 for none (the default). Frames emulated for
+	  * run-ahead are not reported.
+	  */
+	void setEventListener(EventListener *listener);
+
 	/**
 	  * Sets the directory used for storing save data. The default is the same directory as
 	  * the ROM Image file.
@@ -131,6 +495,27 @@ public:
 	/** Writes persistent cartridge data to disk. Done implicitly on ROM close. */
 	void saveSavedata();
 
+	/**
+	  * Returns a new instance, owned by the caller, in the same emulated state as this
+	  * one, for branching into many futures from one state without going through
+	  * serializeState or re-reading the ROM file. The state is copied exactly, mid-frame
+	  * PPU and event timing included, so given the same input a fork and this instance
+	  * produce the same video, audio and state. The ROM image (with any cheats),
+	  * save paths, input getter, palette, audio, run-ahead, speed hack and block
+	  * cache/recompiler settings carry over. Breakpoints, the event listener and
+	  * debugging aids do not, and stats start from zero. A fork does not write save
+	  * data on ROM close, reset or state loads, only when saveSavedata is called, and
+	  * its reset keeps its cartridge RAM rather than reloading it from disk.
+	  *
+	  * Forking brings the emulated state of this instance up to date, like
+	  * serializeState, so it must not run concurrently with any other use of this
+	  * instance, including another fork of it. Forks of different instances, and
+	  * running the forks themselves, may run in parallel.
+	  *
+	  * @return 0 if no ROM image is loaded.
+	  */
+	GB * fork();
+
 //> OpenEmu
     /** Serializes state data to 'stream'
       * @return success
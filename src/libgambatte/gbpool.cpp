@@ -0,0 +1,301 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "gbpool.h"
+#include "array.h"
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace gambatte {
+
+namespace {
+
+enum { video_size = 160 * 144 };
+
+struct PoolInput : InputGetter {
+	unsigned buttons;
+
+	PoolInput() : buttons(0) {}
+	virtual unsigned operator()() { return buttons; }
+};
+
+struct Instance {
+	GB gb;
+	PoolInput input;
+	Array<uint_least32_t> video;
+	Array<uint_least32_t> audio;
+	std::size_t samples;
+
+	Instance()
+	: video(video_size)
+	, audio(GB::runFramesAudioSize(1))
+	, samples(0)
+	{
+		gb.setInputGetter(&input);
+		std::fill(video.get(), video.get() + video_size, 0);
+	}
+};
+
+unsigned onlineCpus() {
+	long const n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+}
+
+void pinToCpu(unsigned cpu) {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % onlineCpus(), &set);
+	pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+#else
+	static_cast<void>(cpu);
+#endif
+}
+
+} // unnamed namespace.
+
+struct GBPool::Priv {
+	// The instances a worker starts a step with, taken from the front by the
+	// worker itself and from the back by the others. Holds a fixed range of
+	// instance indices, so resetting it for a step is just resetting head and tail.
+	struct Worker {
+		Priv *priv;
+		unsigned id;
+		std::size_t begin, end;
+		std::size_t head, tail;
+		pthread_mutex_t mutex;
+		pthread_t thread;
+	};
+
+	Array<Instance *> instances;
+	Array<Worker> workers;
+	unsigned numWorkers;
+	pthread_mutex_t mutex;
+	pthread_cond_t startCond;
+	pthread_cond_t doneCond;
+	unsigned long generation;
+	std::size_t remaining;
+	unsigned frames;
+	bool pin;
+	bool quit;
+
+	Priv(std::size_t size, unsigned threads, bool pin);
+	~Priv();
+	bool take(Worker &w, std::size_t &i);
+	void run(Instance &inst);
+	static void * work(void *worker);
+};
+
+GBPool::Priv::Priv(std::size_t const size, unsigned threads, bool const pinThreads)
+: instances(size)
+, numWorkers(0)
+, generation(0)
+, remaining(0)
+, frames(1)
+, pin(pinThreads)
+, quit(false)
+{
+	for (std::size_t i = 0; i < size; ++i)
+		instances[i] = new Instance;
+
+	if (!threads)
+		threads = onlineCpus();
+	if (threads > size)
+		threads = size ? size : 1;
+
+	pthread_mutex_init(&mutex, 0);
+	pthread_cond_init(&startCond, 0);
+	pthread_cond_init(&doneCond, 0);
+	workers.reset(threads);
+	for (unsigned n = 0; n < threads; ++n) {
+		Worker &w = workers[n];
+		w.priv = this;
+		w.id = n;
+		w.head = w.tail = 0;
+		pthread_mutex_init(&w.mutex, 0);
+		if (pthread_create(&w.thread, 0, work, &w)) {
+			pthread_mutex_destroy(&w.mutex);
+			threads = n;
+			break;
+		}
+	}
+
+	// the workers do not look at their ranges until the first step.
+	numWorkers = threads;
+	for (unsigned n = 0; n < numWorkers; ++n) {
+		workers[n].begin = size * n / numWorkers;
+		workers[n].end = size * (n + 1) / numWorkers;
+	}
+}
+
+GBPool::Priv::~Priv() {
+	pthread_mutex_lock(&mutex);
+	quit = true;
+	pthread_cond_broadcast(&startCond);
+	pthread_mutex_unlock(&mutex);
+
+	for (unsigned n = 0; n < numWorkers; ++n) {
+		pthread_join(workers[n].thread, 0);
+		pthread_mutex_destroy(&workers[n].mutex);
+	}
+
+	pthread_cond_destroy(&doneCond);
+	pthread_cond_destroy(&startCond);
+	pthread_mutex_destroy(&mutex);
+
+	for (std::size_t i = 0; i < instances.size(); ++i)
+		delete instances[i];
+}
+
+// Takes the next instance from w's own queue, or else the last one queued on
+// any other worker. Returns false when every queue is empty.
+bool GBPool::Priv::take(Worker &w, std::size_t &i) {
+	pthread_mutex_lock(&w.mutex);
+	bool const own = w.head != w.tail;
+	if (own)
+		i = w.head++;
+
+	pthread_mutex_unlock(&w.mutex);
+	if (own)
+		return true;
+
+	for (unsigned n = 1; n < numWorkers; ++n) {
+		Worker &victim = workers[(w.id + n) % numWorkers];
+		pthread_mutex_lock(&victim.mutex);
+		bool const stolen = victim.head != victim.tail;
+		if (stolen)
+			i = --victim.tail;
+
+		pthread_mutex_unlock(&victim.mutex);
+		if (stolen)
+			return true;
+	}
+
+	return false;
+}
+
+void GBPool::Priv::run(Instance &inst) {
+	inst.samples = 0;
+	if (inst.gb.isLoaded())
+		inst.gb.runFrames(frames, inst.video, 160, 0, inst.audio, inst.samples);
+}
+
+void * GBPool::Priv::work(void *const worker) {
+	Worker &w = *static_cast<Worker *>(worker);
+	Priv &p = *w.priv;
+	if (p.pin)
+		pinToCpu(w.id);
+
+	unsigned long seen = 0;
+	pthread_mutex_lock(&p.mutex);
+	for (;;) {
+		while (p.generation == seen && !p.quit)
+			pthread_cond_wait(&p.startCond, &p.mutex);
+		if (p.quit)
+			break;
+
+		seen = p.generation;
+		pthread_mutex_unlock(&p.mutex);
+
+		std::size_t i;
+		while (p.take(w, i))
+			p.run(*p.instances[i]);
+
+		pthread_mutex_lock(&p.mutex);
+		if (!--p.remaining)
+			pthread_cond_signal(&p.doneCond);
+	}
+
+	pthread_mutex_unlock(&p.mutex);
+	return 0;
+}
+
+GBPool::GBPool(std::size_t size, unsigned threads, bool pin)
+: p_(new Priv(size, threads, pin))
+{
+}
+
+GBPool::~GBPool() {
+	delete p_;
+}
+
+std::size_t GBPool::size() const {
+	return p_->instances.size();
+}
+
+unsigned GBPool::threads() const {
+	return p_->numWorkers;
+}
+
+GB & GBPool::operator[](std::size_t i) {
+	return p_->instances[i]->gb;
+}
+
+void GBPool::setInput(std::size_t i, unsigned buttons) {
+	p_->instances[i]->input.buttons = buttons;
+}
+
+// The workers only look at the queues and frames after seeing the new
+// generation under the pool mutex, and a step does not return before every
+// worker has found all queues empty, so they can be set up here unlocked.
+void GBPool::step(unsigned const frames) {
+	std::size_t const audioSize = GB::runFramesAudioSize(frames);
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (p_->instances[i]->audio.size() < audioSize)
+			p_->instances[i]->audio.reset(audioSize);
+	}
+
+	p_->frames = frames;
+	if (!p_->numWorkers) {
+		for (std::size_t i = 0; i < size(); ++i)
+			p_->run(*p_->instances[i]);
+
+		return;
+	}
+
+	for (unsigned n = 0; n < p_->numWorkers; ++n) {
+		Priv::Worker &w = p_->workers[n];
+		w.head = w.begin;
+		w.tail = w.end;
+	}
+
+	pthread_mutex_lock(&p_->mutex);
+	p_->remaining = p_->numWorkers;
+	++p_->generation;
+	pthread_cond_broadcast(&p_->startCond);
+	while (p_->remaining)
+		pthread_cond_wait(&p_->doneCond, &p_->mutex);
+
+	pthread_mutex_unlock(&p_->mutex);
+}
+
+uint_least32_t const * GBPool::videoBuffer(std::size_t i) const {
+	return p_->instances[i]->video;
+}
+
+uint_least32_t const * GBPool::audioBuffer(std::size_t i) const {
+	return p_->instances[i]->audio;
+}
+
+std::size_t GBPool::audioSamples(std::size_t i) const {
+	return p_->instances[i]->samples;
+}
+
+}
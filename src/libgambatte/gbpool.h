@@ -0,0 +1,83 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef GAMBATTE_GBPOOL_H
+#define GAMBATTE_GBPOOL_H
+
+#include "gambatte.h"
+#include <cstddef>
+
+namespace gambatte {
+
+/**
+  * Owns a number of GB instances and runs them in parallel on a pool of worker
+  * threads, every instance advancing by the same number of frames per step.
+  *
+  * The instances are split evenly between the workers. A worker that has run all
+  * of its own instances takes queued ones from other workers, so a game that is
+  * slow to emulate does not hold up the whole step. Each instance has its own
+  * input, video and audio buffers, allocated up front.
+  */
+class GBPool {
+public:
+	/**
+	  * @param size    number of GB instances.
+	  * @param threads number of worker threads, or 0 for one per online CPU. No more
+	  *                threads than instances are started.
+	  * @param pin     if true, worker n is bound to CPU n (modulo the CPU count) on
+	  *                systems that support it (Linux). It is left unbound elsewhere.
+	  */
+	explicit GBPool(std::size_t size, unsigned threads = 0, bool pin = false);
+	~GBPool();
+
+	std::size_t size() const;
+	unsigned threads() const;
+
+	/**
+	  * Instance i, for loading a ROM and other setup. It must not be used while step
+	  * runs. Its input getter is owned by the pool, see setInput.
+	  */
+	GB & operator[](std::size_t i);
+
+	/** Sets the buttons (see InputGetter) that instance i holds in the following steps. */
+	void setInput(std::size_t i, unsigned buttons);
+
+	/**
+	  * Runs every loaded instance for 'frames' frames, as runFrames counts them,
+	  * and returns when all of them are done.
+	  */
+	void step(unsigned frames = 1);
+
+	/** The last frame drawn by instance i in the last step: 160x144 pixels, pitch 160. */
+	uint_least32_t const * videoBuffer(std::size_t i) const;
+
+	/** The audio produced by instance i in the last step, in runFor's format. */
+	uint_least32_t const * audioBuffer(std::size_t i) const;
+
+	/** The number of samples in audioBuffer(i). */
+	std::size_t audioSamples(std::size_t i) const;
+
+private:
+	struct Priv;
+	Priv *const p_;
+
+	GBPool(GBPool const &);
+	GBPool & operator=(GBPool const &);
+};
+
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "interrupter.h"
 #include "memory.h"
+#include "timeline.h"
 
 namespace gambatte {
 
@@ -37,7 +38,15 @@ void Interrupter::prefetch(unsigned long cc, Memory &mem) {
 	}
 }
 
+#ifdef GAMBATTE_TIMELINE
+static char const * irqName(unsigned address) {
+	static char const * const names[] = { "vblank", "stat", "timer", "serial", "joypad" };
+	return address ? names[(address - 0x40) >> 3] : "cancelled";
+}
+#endif
+
 unsigned long Interrupter::interrupt(unsigned long cc, Memory &memory) {
+	TIMELINE_BEGIN(memory.timeline(), span, cc);
 	// undo prefetch (presumably unconditional on hw).
 	if (prefetched_) {
 		pc_ = (pc_ - 1) & 0xFFFF;
@@ -66,6 +75,7 @@ unsigned long Interrupter::interrupt(unsigned long cc, Memory &memory) {
 	if (address == 0x40 && !gsCodes_.empty())
 		applyVblankCheats(cc, memory);
 
+	TIMELINE_END(memory.timeline(), span, track_irq, irqName(address), cc);
 	return cc;
 }
 
@@ -0,0 +1,429 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "jit.h"
+
+#if defined(__x86_64__) && !defined(_WIN32) && !defined(GAMBATTE_NO_JIT)
+#define GAMBATTE_HAVE_JIT 1
+#include <sys/mman.h>
+#endif
+
+#include <cstddef>
+
+using namespace gambatte;
+
+#ifdef GAMBATTE_HAVE_JIT
+
+namespace {
+
+enum { code_buffer_size = 0x40000, max_block_code_size = 0x400 };
+enum { hf2_incf = 0x800, hf2_subf = 0x400, hf2_hcf = 0x200 };
+
+typedef unsigned long (*NativeBlock)(JitRegs *);
+
+// x86-64 register numbers used in ModRM fields. rdi holds the JitRegs pointer.
+enum { eax = 0, ecx = 1, edx = 2 };
+
+int regOffset(unsigned r) {
+	switch (r) {
+	case 0: return offsetof(JitRegs, b);
+	case 1: return offsetof(JitRegs, c);
+	case 2: return offsetof(JitRegs, d);
+	case 3: return offsetof(JitRegs, e);
+	case 4: return offsetof(JitRegs, h);
+	case 5: return offsetof(JitRegs, l);
+	case 7: return offsetof(JitRegs, a);
+	}
+
+	return -1;
+}
+
+class Emitter {
+public:
+	explicit Emitter(unsigned char *p) : p_(p) {}
+	unsigned char * pos() const { return p_; }
+
+	void byte(unsigned b) { *p_++ = b & 0xFF; }
+
+	void dword(unsigned long d) {
+		byte(d);
+		byte(d >> 8);
+		byte(d >> 16);
+		byte(d >> 24);
+	}
+
+	// op reg, [rdi + off]
+	void rm(unsigned op, unsigned reg, int off) { byte(op); byte(0x47 | reg << 3); byte(off); }
+	void rm0f(unsigned op, unsigned reg, int off) { byte(0x0F); rm(op, reg, off); }
+
+	void loadByte(unsigned reg, int off) { rm0f(0xB6, reg, off); }  // movzx reg, byte [rdi+off]
+	void loadWord(unsigned reg, int off) { rm0f(0xB7, reg, off); }  // movzx reg, word [rdi+off]
+	void load(unsigned reg, int off) { rm(0x8B, reg, off); }        // mov reg, [rdi+off]
+	void store(int off, unsigned reg) { rm(0x89, reg, off); }       // mov [rdi+off], reg
+	void storeByte(int off, unsigned reg) { rm(0x88, reg, off); }   // mov [rdi+off], reg8
+	void storeAh(int off) { rm(0x88, 4, off); }                     // mov [rdi+off], ah
+	void storeWord(int off, unsigned reg) { byte(0x66); store(off, reg); }
+	void storeImm(int off, unsigned long imm) { rm(0xC7, 0, off); dword(imm); }
+	void storeByteImm(int off, unsigned imm) { rm(0xC6, 0, off); byte(imm); }
+	void movImm(unsigned reg, unsigned long imm) { byte(0xB8 + reg); dword(imm); }
+	void movRR(unsigned dst, unsigned src) { byte(0x89); byte(0xC0 | src << 3 | dst); }
+	void aluRR(unsigned op, unsigned dst, unsigned src) { byte(op); byte(0xC0 | src << 3 | dst); }
+	void aluImm(unsigned ext, unsigned reg, unsigned long imm) { byte(0x81); byte(0xC0 | ext << 3 | reg); dword(imm); }
+	void shr8(unsigned reg) { byte(0xC1); byte(0xE8 | reg); byte(8); }
+	void shl8(unsigned reg) { byte(0xC1); byte(0xE0 | reg); byte(8); }
+	void inc(unsigned reg) { byte(0xFF); byte(0xC0 | reg); }
+	void dec(unsigned reg) { byte(0xFF); byte(0xC8 | reg); }
+	void testByteImm(int off, unsigned imm) { rm(0xF6, 0, off); byte(imm); }
+	void ret() { byte(0xC3); }
+
+private:
+	unsigned char *p_;
+};
+
+enum { alu_add = 0x01, alu_or = 0x09, alu_and = 0x21, alu_sub = 0x29, alu_xor = 0x31 };
+enum { ext_or = 1, ext_and = 4 };
+
+int const off_hf1 = offsetof(JitRegs, hf1);
+int const off_hf2 = offsetof(JitRegs, hf2);
+int const off_zf = offsetof(JitRegs, zf);
+int const off_cf = offsetof(JitRegs, cf);
+int const off_sp = offsetof(JitRegs, sp);
+int const off_a = offsetof(JitRegs, a);
+
+// edx = u8 operand. op is 0-7: add adc sub sbc and xor or cp.
+void emitAlu(Emitter &e, unsigned op) {
+	switch (op) {
+	case 0: // add
+		e.loadByte(eax, off_a);
+		e.store(off_hf1, eax);
+		e.store(off_hf2, edx);
+		e.aluRR(alu_add, eax, edx);
+		e.store(off_zf, eax);
+		e.store(off_cf, eax);
+		e.storeByte(off_a, eax);
+		break;
+	case 1: // adc
+		e.loadByte(eax, off_a);
+		e.store(off_hf1, eax);
+		e.load(ecx, off_cf);
+		e.aluImm(ext_and, ecx, 0x100);
+		e.aluRR(alu_or, ecx, edx);
+		e.store(off_hf2, ecx);
+		e.shr8(ecx);
+		e.aluRR(alu_add, eax, ecx);
+		e.aluRR(alu_add, eax, edx);
+		e.store(off_zf, eax);
+		e.store(off_cf, eax);
+		e.storeByte(off_a, eax);
+		break;
+	case 2: // sub
+	case 7: // cp
+		e.loadByte(eax, off_a);
+		e.store(off_hf1, eax);
+		e.aluRR(alu_sub, eax, edx);
+		e.store(off_zf, eax);
+		e.store(off_cf, eax);
+		if (op == 2)
+			e.storeByte(off_a, eax);
+
+		e.aluImm(ext_or, edx, hf2_subf);
+		e.store(off_hf2, edx);
+		break;
+	case 3: // sbc
+		e.loadByte(eax, off_a);
+		e.store(off_hf1, eax);
+		e.load(ecx, off_cf);
+		e.aluImm(ext_and, ecx, 0x100);
+		e.aluRR(alu_or, ecx, edx);
+		e.aluImm(ext_or, ecx, hf2_subf);
+		e.store(off_hf2, ecx);
+		e.aluImm(ext_and, ecx, 0x100);
+		e.shr8(ecx);
+		e.aluRR(alu_sub, eax, ecx);
+		e.aluRR(alu_sub, eax, edx);
+		e.store(off_zf, eax);
+		e.store(off_cf, eax);
+		e.storeByte(off_a, eax);
+		break;
+	case 4: // and
+		e.storeImm(off_hf2, hf2_hcf);
+		e.storeImm(off_cf, 0);
+		e.loadByte(eax, off_a);
+		e.aluRR(alu_and, eax, edx);
+		e.storeByte(off_a, eax);
+		e.store(off_zf, eax);
+		break;
+	case 5: // xor
+	case 6: // or
+		e.storeImm(off_hf2, 0);
+		e.storeImm(off_cf, 0);
+		e.loadByte(eax, off_a);
+		e.aluRR(op == 5 ? alu_xor : alu_or, eax, edx);
+		e.storeByte(off_a, eax);
+		e.store(off_zf, eax);
+		break;
+	}
+}
+
+void emitReturn(Emitter &e, unsigned pc, unsigned cycles) {
+	e.movImm(eax, cycles << 16 | (pc & 0xFFFF));
+	e.ret();
+}
+
+// Emits a conditional branch exit. cc is 0-3: nz z nc c.
+void emitCondReturn(Emitter &e, unsigned cc,
+		unsigned takenPc, unsigned takenCycles, unsigned pc, unsigned cycles) {
+	if (cc < 2)
+		e.testByteImm(off_zf, 0xFF);
+	else
+		e.testByteImm(off_cf + 1, 0x01);
+
+	// nz and c are taken on a set bit.
+	e.byte(cc == 0 || cc == 3 ? 0x75 : 0x74);
+	e.byte(6);
+	emitReturn(e, pc, cycles);
+	emitReturn(e, takenPc, takenCycles);
+}
+
+// Emits op if it is register-only. Returns its cycle count, or 0 if it cannot be
+// translated. Branches are emitted as block exits and report 'exit'.
+unsigned emitOp(Emitter &e, DecodedOp const &op, unsigned cyclesBefore, bool &exit) {
+	unsigned const opcode = op.opcode;
+	unsigned const npc = op.pc + op.size;
+	exit = false;
+
+	if (opcode >= 0x40 && opcode < 0x80) {
+		int const dst = regOffset(opcode >> 3 & 7);
+		int const src = regOffset(opcode & 7);
+		if (dst < 0 || src < 0)
+			return 0;
+
+		e.loadByte(eax, src);
+		e.storeByte(dst, eax);
+		return 4;
+	}
+
+	if (opcode >= 0x80 && opcode < 0xC0) {
+		int const src = regOffset(opcode & 7);
+		if (src < 0)
+			return 0;
+
+		e.loadByte(edx, src);
+		emitAlu(e, opcode >> 3 & 7);
+		return 4;
+	}
+
+	if ((opcode & 0xC7) == 0xC6 && opcode >= 0xC0) {
+		e.movImm(edx, op.imm[0]);
+		emitAlu(e, opcode >> 3 & 7);
+		return 8;
+	}
+
+	if (opcode < 0x40 && (opcode & 7) >= 4 && (opcode & 7) <= 6) {
+		int const r = regOffset(opcode >> 3 & 7);
+		if (r < 0)
+			return 0;
+
+		if ((opcode & 7) == 6) {
+			e.storeByteImm(r, op.imm[0]);
+			return 8;
+		}
+
+		e.loadByte(eax, r);
+		e.movRR(edx, eax);
+		e.aluImm(ext_or, edx, (opcode & 7) == 4 ? hf2_incf : hf2_incf | hf2_subf);
+		e.store(off_hf2, edx);
+		if ((opcode & 7) == 4)
+			e.inc(eax);
+		else
+			e.dec(eax);
+
+		e.store(off_zf, eax);
+		e.storeByte(r, eax);
+		return 4;
+	}
+
+	switch (opcode) {
+	case 0x00:
+		return 4;
+	case 0x01:
+	case 0x11:
+	case 0x21:
+		e.storeByteImm(regOffset((opcode >> 3) + 1), op.imm[0]);
+		e.storeByteImm(regOffset(opcode >> 3), op.imm[1]);
+		return 12;
+	case 0x31:
+		e.movImm(eax, op.imm[1] << 8 | op.imm[0]);
+		e.storeWord(off_sp, eax);
+		return 12;
+	case 0x03:
+	case 0x0B:
+	case 0x13:
+	case 0x1B:
+	case 0x23:
+	case 0x2B:
+		e.loadByte(eax, regOffset((opcode >> 3 & 6) + 1));
+		e.loadByte(edx, regOffset(opcode >> 3 & 6));
+		e.shl8(edx);
+		e.aluRR(alu_or, eax, edx);
+		if (opcode & 8)
+			e.dec(eax);
+		else
+			e.inc(eax);
+
+		e.storeByte(regOffset((opcode >> 3 & 6) + 1), eax);
+		e.storeAh(regOffset(opcode >> 3 & 6));
+		return 8;
+	case 0x33:
+	case 0x3B:
+		e.loadWord(eax, off_sp);
+		if (opcode & 8)
+			e.dec(eax);
+		else
+			e.inc(eax);
+
+		e.storeWord(off_sp, eax);
+		return 8;
+	case 0x2F:
+		e.storeImm(off_hf2, hf2_subf | hf2_hcf);
+		e.loadByte(eax, off_a);
+		e.aluImm(6, eax, 0xFF); // xor
+		e.storeByte(off_a, eax);
+		return 4;
+	case 0x18:
+		exit = true;
+		emitReturn(e, npc + static_cast<signed char>(op.imm[0]), cyclesBefore + 12);
+		return 12;
+	case 0x20:
+	case 0x28:
+	case 0x30:
+	case 0x38:
+		exit = true;
+		emitCondReturn(e, opcode >> 3 & 3,
+			npc + static_cast<signed char>(op.imm[0]), cyclesBefore + 12,
+			npc, cyclesBefore + 8);
+		return 8;
+	case 0xC3:
+		exit = true;
+		emitReturn(e, op.imm[1] << 8 | op.imm[0], cyclesBefore + 16);
+		return 16;
+	case 0xC2:
+	case 0xCA:
+	case 0xD2:
+	case 0xDA:
+		exit = true;
+		emitCondReturn(e, opcode >> 3 & 3,
+			op.imm[1] << 8 | op.imm[0], cyclesBefore + 16,
+			npc, cyclesBefore + 12);
+		return 12;
+	}
+
+	return 0;
+}
+
+} // unnamed namespace.
+
+Jit::Jit()
+: code_(0)
+, codeUsed_(0)
+, mode_(mode_off)
+{
+}
+
+Jit::~Jit() {
+	setMode(mode_off);
+}
+
+bool Jit::available() {
+	return true;
+}
+
+bool Jit::setMode(Mode mode) {
+	if (mode != mode_off && !code_) {
+		void *const p = mmap(0, code_buffer_size, PROT_READ | PROT_WRITE | PROT_EXEC,
+		                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			mode_ = mode_off;
+			return false;
+		}
+
+		code_ = static_cast<unsigned char *>(p);
+		codeUsed_ = 0;
+	} else if (mode == mode_off && code_) {
+		munmap(code_, code_buffer_size);
+		code_ = 0;
+	}
+
+	mode_ = mode;
+	return true;
+}
+
+bool Jit::compile(BlockCache::Block &block) {
+	if (codeUsed_ + max_block_code_size > code_buffer_size)
+		return false;
+
+	Emitter e(code_ + codeUsed_);
+	unsigned cycles = 0;
+	unsigned lead = 0;
+	unsigned n = 0;
+	bool exit = false;
+
+	while (n < block.numOps && !exit) {
+		unsigned const opCycles = emitOp(e, block.ops[n], cycles, exit);
+		if (!opCycles)
+			break;
+
+		lead = cycles;
+		cycles += opCycles;
+		++n;
+	}
+
+	// a single op gains nothing over the interpreter.
+	if (n < 2)
+		return true;
+
+	if (!exit)
+		emitReturn(e, block.ops[n - 1].pc + block.ops[n - 1].size, cycles);
+
+	block.native = code_ + codeUsed_;
+	block.nativeOps = n;
+	block.nativeLead = lead;
+	codeUsed_ = e.pos() - code_;
+	return true;
+}
+
+unsigned long Jit::run(BlockCache::Block const &block, JitRegs &regs) {
+	union { unsigned char const *p; NativeBlock f; } fn;
+	fn.p = block.native;
+	return fn.f(&regs);
+}
+
+#else
+
+Jit::Jit()
+: code_(0)
+, codeUsed_(0)
+, mode_(mode_off)
+{
+}
+
+Jit::~Jit() {}
+bool Jit::available() { return false; }
+bool Jit::setMode(Mode mode) { return mode == mode_off; }
+bool Jit::compile(BlockCache::Block &) { return true; }
+unsigned long Jit::run(BlockCache::Block const &, JitRegs &) { return 0; }
+
+#endif
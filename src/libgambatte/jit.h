@@ -0,0 +1,71 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "blockcache.h"
+#include "uncopyable.h"
+#include <cstddef>
+
+namespace gambatte {
+
+// CPU registers as seen by native code, copied in and out around each native block.
+// Flags use the same lazy representation as the interpreter.
+struct JitRegs {
+	unsigned hf1, hf2, zf, cf;
+	unsigned short sp;
+	unsigned char a, b, c, d, e, h, l;
+};
+
+// x86-64 recompiler for hot cached blocks. Only the leading run of register-only
+// instructions of a ROM block (plus an optional closing jr/jp) is translated. Those
+// cannot touch memory or I/O, and so cannot change the next event time either,
+// which lets the CPU decide up front whether the whole run completes before the
+// next event. Everything else is left to the interpreter.
+//
+// Compiled in on x86-64 SysV targets unless GAMBATTE_NO_JIT is defined.
+class Jit : Uncopyable {
+public:
+	enum Mode { mode_off, mode_on, mode_verify };
+	enum { hot_threshold = 16 };
+
+	Jit();
+	~Jit();
+	static bool available();
+	Mode mode() const { return mode_; }
+	bool setMode(Mode mode);
+
+	/**
+	  * Translates a prefix of block if worthwhile. Returns false if the code buffer is
+	  * full, in which case the caller must drop all native code (invalidating the block
+	  * cache) and call flush().
+	  */
+	bool compile(BlockCache::Block &block);
+	void flush() { codeUsed_ = 0; }
+
+	/** Runs the native code of block. Returns the next pc | cycles used << 16. */
+	static unsigned long run(BlockCache::Block const &block, JitRegs &regs);
+
+private:
+	unsigned char *code_;
+	std::size_t codeUsed_;
+	Mode mode_;
+};
+
+}
+
+#endif
@@ -567,6 +567,49 @@ LoadRes Cartridge::loadROM(File &file,
 	if (file.fail())
 		return LOADRES_IO_ERROR;
 
+	std::size_t const filesize = file.size();
+	unsigned const rombanks = std::max(pow2ceil(filesize / 0x4000), 2u);
+	RomImage *rom = 0;
+	if (file.mapping() && filesize == rombanks * 0x4000ul && !static_cast<unsigned char>(0x100)) {
+		// no padding or masking needed, so the banks can point into the mapping. the
+		// image is kept to this instance and its forks rather than shared by content,
+		// so that a change to the file cannot reach other instances.
+		rom = RomImage::map(file.mapping(), rombanks);
+		file.releaseMapping();
+	} else {
+		rom = RomImage::create(rombanks);
+		file.read(reinterpret_cast<char*>(rom->buffer()), filesize / 0x4000 * 0x4000ul);
+		std::memset(rom->buffer() + filesize / 0x4000 * 0x4000ul,
+		            0xFF,
+		            (rombanks - filesize / 0x4000) * 0x4000ul);
+		enforce8bit(rom->buffer(), rombanks * 0x4000ul);
+
+		if (file.fail()) {
+			RomImage::release(rom);
+			return LOADRES_IO_ERROR;
+		}
+
+		rom = RomImage::share(rom);
+	}
+
+	if (LoadRes const fail = loadImage(rom, forceDmg, multicartCompat))
+		return fail;
+
+	defaultSaveBasePath_ = stripExtension(filename);
+	return LOADRES_OK;
+}
+
+LoadRes Cartridge::loadROM(Cartridge const &parent, bool const forceDmg, bool const multicartCompat) {
+	if (LoadRes const fail = loadImage(RomImage::addRef(parent.memptrs_.rom()), forceDmg, multicartCompat))
+		return fail;
+
+	defaultSaveBasePath_ = parent.defaultSaveBasePath_;
+	saveDir_ = parent.saveDir_;
+	memptrs_.copyRomPatches(parent.memptrs_);
+	return LOADRES_OK;
+}
+
+LoadRes Cartridge::loadImage(RomImage *const rom, bool const forceDmg, bool const multicartCompat) {
 	enum Cartridgetype { type_plain,
 	                     type_mbc1,
 	                     type_mbc2,
@@ -574,94 +617,61 @@ LoadRes Cartridge::loadROM(File &file,
 	                     type_mbc5,
 	                     type_huc1 };
 	Cartridgetype type = type_plain;
-	unsigned rambanks = 1;
-	unsigned rombanks = 2;
-	bool cgb = false;
-
-	{
-		unsigned char header[0x150];
-		file.read(reinterpret_cast<char *>(header), sizeof header);
-
-		switch (header[0x0147]) {
-		case 0x00: type = type_plain; break;
-		case 0x01:
-		case 0x02:
-		case 0x03: type = type_mbc1; break;
-		case 0x05:
-		case 0x06: type = type_mbc2; break;
-		case 0x08:
-		case 0x09: type = type_plain; break;
-		case 0x0B:
-		case 0x0C:
-		case 0x0D: return LOADRES_UNSUPPORTED_MBC_MMM01;
-		case 0x0F:
-		case 0x10:
-		case 0x11:
-		case 0x12:
-		case 0x13: type = type_mbc3; break;
-		case 0x15:
-		case 0x16:
-		case 0x17: return LOADRES_UNSUPPORTED_MBC_MBC4;
-		case 0x19:
-		case 0x1A:
-		case 0x1B:
-		case 0x1C:
-		case 0x1D:
-		case 0x1E: type = type_mbc5; break;
-		case 0x20: return LOADRES_UNSUPPORTED_MBC_MBC6;
-		case 0x22: return LOADRES_UNSUPPORTED_MBC_MBC7;
-		case 0xFC: return LOADRES_UNSUPPORTED_MBC_POCKET_CAMERA;
-		case 0xFD: return LOADRES_UNSUPPORTED_MBC_TAMA5;
-		case 0xFE: return LOADRES_UNSUPPORTED_MBC_HUC3;
-		case 0xFF: type = type_huc1; break;
-		default:   return LOADRES_BAD_FILE_OR_UNKNOWN_MBC;
-		}
+	unsigned char const *const header = rom->data();
+	LoadRes unsupported = LOADRES_OK;
+
+	switch (header[0x0147]) {
+	case 0x00: type = type_plain; break;
+	case 0x01:
+	case 0x02:
+	case 0x03: type = type_mbc1; break;
+	case 0x05:
+	case 0x06: type = type_mbc2; break;
+	case 0x08:
+	case 0x09: type = type_plain; break;
+	case 0x0B:
+	case 0x0C:
+	case 0x0D: unsupported = LOADRES_UNSUPPORTED_MBC_MMM01; break;
+	case 0x0F:
+	case 0x10:
+	case 0x11:
+	case 0x12:
+	case 0x13: type = type_mbc3; break;
+	case 0x15:
+	case 0x16:
+	case 0x17: unsupported = LOADRES_UNSUPPORTED_MBC_MBC4; break;
+	case 0x19:
+	case 0x1A:
+	case 0x1B:
+	case 0x1C:
+	case 0x1D:
+	case 0x1E: type = type_mbc5; break;
+	case 0x20: unsupported = LOADRES_UNSUPPORTED_MBC_MBC6; break;
+	case 0x22: unsupported = LOADRES_UNSUPPORTED_MBC_MBC7; break;
+	case 0xFC: unsupported = LOADRES_UNSUPPORTED_MBC_POCKET_CAMERA; break;
+	case 0xFD: unsupported = LOADRES_UNSUPPORTED_MBC_TAMA5; break;
+	case 0xFE: unsupported = LOADRES_UNSUPPORTED_MBC_HUC3; break;
+	case 0xFF: type = type_huc1; break;
+	default:   unsupported = LOADRES_BAD_FILE_OR_UNKNOWN_MBC; break;
+	}
 
-		/*switch (header[0x0148]) {
-		case 0x00: rombanks = 2; break;
-		case 0x01: rombanks = 4; break;
-		case 0x02: rombanks = 8; break;
-		case 0x03: rombanks = 16; break;
-		case 0x04: rombanks = 32; break;
-		case 0x05: rombanks = 64; break;
-		case 0x06: rombanks = 128; break;
-		case 0x07: rombanks = 256; break;
-		case 0x08: rombanks = 512; break;
-		case 0x52: rombanks = 72; break;
-		case 0x53: rombanks = 80; break;
-		case 0x54: rombanks = 96; break;
-		default: return -1;
-		}*/
-
-		rambanks = numRambanksFromH14x(header[0x147], header[0x149]);
-		cgb = header[0x0143] >> 7 & (1 ^ forceDmg);
+	if (unsupported) {
+		RomImage::release(rom);
+		return unsupported;
 	}
 
-	std::size_t const filesize = file.size();
-	rombanks = std::max(pow2ceil(filesize / 0x4000), 2u);
+	unsigned const rambanks = numRambanksFromH14x(header[0x147], header[0x149]);
+	bool const cgb = header[0x0143] >> 7 & (1 ^ forceDmg);
 
 	defaultSaveBasePath_.clear();
-	ggUndoList_.clear();
 	mbc_.reset();
-	memptrs_.reset(rombanks, rambanks, cgb ? 8 : 2);
+	memptrs_.reset(rom, rambanks, cgb ? 8 : 2);
 	rtc_.set(false, 0);
 
-	file.rewind();
-	file.read(reinterpret_cast<char*>(memptrs_.romdata()), filesize / 0x4000 * 0x4000ul);
-	std::memset(memptrs_.romdata() + filesize / 0x4000 * 0x4000ul,
-	            0xFF,
-	            (rombanks - filesize / 0x4000) * 0x4000ul);
-	enforce8bit(memptrs_.romdata(), rombanks * 0x4000ul);
-
-	if (file.fail())
-		return LOADRES_IO_ERROR;
-
-	defaultSaveBasePath_ = stripExtension(filename);
-
 	switch (type) {
 	case type_plain: mbc_.reset(new Mbc0(memptrs_)); break;
 	case type_mbc1:
-		if (multicartCompat && presumedMulti64Mbc1(memptrs_.romdata(), rombanks)) {
+		if (multicartCompat && presumedMulti64Mbc1(memptrs_.romdata(), rom->banks())) {
 			mbc_.reset(new Mbc1Multi64(memptrs_));
 		} else
 			mbc_.reset(new Mbc1(memptrs_));
@@ -737,10 +747,8 @@ void Cartridge::applyGameGenie(std::string const &code) {
 
 		for (unsigned bank = 0; bank < rombanks(memptrs_); ++bank) {
 			if (mbc_->isAddressWithinAreaRombankCanBeMappedTo(addr, bank)
-					&& (cmp > 0xFF || memptrs_.romdata()[bank * rombank_size() + addr % rombank_size()] == cmp)) {
-				ggUndoList_.push_back(AddrData(bank * rombank_size() + addr % rombank_size(),
-				                      memptrs_.romdata()[bank * rombank_size() + addr % rombank_size()]));
-				memptrs_.romdata()[bank * rombank_size() + addr % rombank_size()] = val;
+					&& (cmp > 0xFF || memptrs_.romByte(bank * rombank_size() + addr % rombank_size()) == cmp)) {
+				memptrs_.patchRom(bank * rombank_size() + addr % rombank_size(), val);
 			}
 		}
 	}
@@ -748,13 +756,7 @@ void Cartridge::applyGameGenie(std::string const &code) {
 
 void Cartridge::setGameGenie(std::string const &codes) {
 	if (loaded()) {
-		for (std::vector<AddrData>::reverse_iterator it =
-				ggUndoList_.rbegin(), end = ggUndoList_.rend(); it != end; ++it) {
-			if (memptrs_.romdata() + it->addr < memptrs_.romdataend())
-				memptrs_.romdata()[it->addr] = it->data;
-		}
-
-		ggUndoList_.clear();
+		memptrs_.clearRomPatches();
 
 		std::string code;
 		for (std::size_t pos = 0; pos < codes.length(); pos += code.length() + 1) {
@@ -49,9 +49,16 @@ public:
 	bool loaded() const { return mbc_.get(); }
 	unsigned char const * rmem(unsigned area) const { return memptrs_.rmem(area); }
 	unsigned char * wmem(unsigned area) const { return memptrs_.wmem(area); }
+	unsigned char const * rpage(unsigned page) const { return memptrs_.rpage(page); }
+	unsigned char * wpage(unsigned page) const { return memptrs_.wpage(page); }
 	unsigned char * vramdata() const { return memptrs_.vramdata(); }
-	unsigned char * romdata(unsigned area) const { return memptrs_.romdata(area); }
+	unsigned char * rambankdata() const { return memptrs_.rambankdata(); }
+	unsigned char * rambankdataend() const { return memptrs_.rambankdataend(); }
+	unsigned char const * romdata() const { return memptrs_.romdata(); }
+	unsigned char const * romdata(unsigned area) const { return memptrs_.romdata(area); }
+	unsigned romBank(unsigned area) const { return memptrs_.romBank(area); }
 	unsigned char * wramdata(unsigned area) const { return memptrs_.wramdata(area); }
+	unsigned char * wramdataend() const { return memptrs_.wramdataend(); }
 	unsigned char const * rdisabledRam() const { return memptrs_.rdisabledRam(); }
 	unsigned char const * rsrambankptr() const { return memptrs_.rsrambankptr(); }
 	unsigned char * wsrambankptr() const { return memptrs_.wsrambankptr(); }
@@ -61,6 +68,7 @@ public:
 	void setVrambank(unsigned bank) { memptrs_.setVrambank(bank); }
 	void setWrambank(unsigned bank) { memptrs_.setWrambank(bank); }
 	void setOamDmaSrc(OamDmaSrc oamDmaSrc) { memptrs_.setOamDmaSrc(oamDmaSrc); }
+	void setPageTraps(unsigned page, unsigned trapFlags) { memptrs_.setPageTraps(page, trapFlags); }
 	void mbcWrite(unsigned addr, unsigned data) { mbc_->romWrite(addr, data); }
 	bool isCgb() const { return gambatte::isCgb(memptrs_); }
 	void rtcWrite(unsigned data) { rtc_.write(data); }
@@ -70,24 +78,22 @@ public:
 	std::string const saveBasePath() const;
 	void setSaveDir(std::string const &dir);
 	LoadRes loadROM(File &file, std::string const &filename, bool forceDmg, bool multicartCompat);
+
+	// Maps the ROM image of parent, Game Genie codes and save paths included.
+	// The mutable state is left to be copied separately.
+	LoadRes loadROM(Cartridge const &parent, bool forceDmg, bool multicartCompat);
 	char const * romTitle() const { return reinterpret_cast<char const *>(memptrs_.romdata() + 0x134); }
 	class PakInfo const pakInfo(bool multicartCompat) const;
 	void setGameGenie(std::string const &codes);
 
 private:
-	struct AddrData {
-		unsigned long addr;
-		unsigned char data;
-		AddrData(unsigned long _addr, unsigned _data) : addr(_addr), data(_data) {}
-	};
-
 	MemPtrs memptrs_;
 	Rtc rtc_;
 	scoped_ptr<Mbc> mbc_;
 	std::string defaultSaveBasePath_;
 	std::string saveDir_;
-	std::vector<AddrData> ggUndoList_;
 
+	LoadRes loadImage(RomImage *rom, bool forceDmg, bool multicartCompat);
 	void applyGameGenie(std::string const &code);
 };
 
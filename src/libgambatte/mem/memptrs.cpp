@@ -74,29 +74,43 @@ void disconnectOamDmaAreas(unsigned char const *(&rmem)[0x10], unsigned char *(&
 MemPtrs::MemPtrs()
 : rmem_()
 , wmem_()
+, rpage_()
+, wpage_()
+, pageTraps_()
+, numTrappedPages_(0)
 , romdata_()
+, romBank_()
 , wramdata_()
 , vrambankptr_(0)
 , rsrambankptr_(0)
 , wsrambankptr_(0)
+, rom_(0)
 , rambankdata_(0)
 , wramdataend_(0)
 , oamDmaSrc_(oam_dma_src_off)
 {
 }
 
-void MemPtrs::reset(unsigned const rombanks, unsigned const rambanks, unsigned const wrambanks) {
+MemPtrs::~MemPtrs() {
+	clearPatchBanks();
+	RomImage::release(rom_);
+}
+
+void MemPtrs::reset(RomImage *const rom, unsigned const rambanks, unsigned const wrambanks) {
 	int const num_disabled_ram_areas = 2;
+	clearPatchBanks();
+	RomImage::release(rom_);
+	rom_ = rom;
+	romPatches_.assign(rom->banks(), static_cast<unsigned char *>(0));
 	memchunk_.reset(
-		  pre_rom_pad_size()
-		+ rombanks * rombank_size()
-		+ max_num_vrambanks * vrambank_size()
+		  max_num_vrambanks * vrambank_size()
 		+ rambanks * rambank_size()
 		+ wrambanks * wrambank_size()
 		+ num_disabled_ram_areas * rambank_size());
 
+	romBank_[0] = 0;
 	romdata_[0] = romdata();
-	rambankdata_ = romdata_[0] + rombanks * rombank_size() + max_num_vrambanks * vrambank_size();
+	rambankdata_ = memchunk_ + max_num_vrambanks * vrambank_size();
 	wramdata_[0] = rambankdata_ + rambanks * rambank_size();
 	wramdataend_ = wramdata_[0] + wrambanks * wrambank_size();
 
@@ -110,18 +124,23 @@ void MemPtrs::reset(unsigned const rombanks, unsigned const rambanks, unsigned c
 	setRambank(0, 0);
 	setVrambank(0);
 	setWrambank(1);
+	remapPages(0x0, 0xF);
 }
 
 void MemPtrs::setRombank0(unsigned bank) {
-	romdata_[0] = romdata() + bank * rombank_size();
+	romBank_[0] = bank;
+	romdata_[0] = romBankData(bank);
 	rmem_[0x3] = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
 	disconnectOamDmaAreas();
+	remapPages(0x0, 0x4);
 }
 
 void MemPtrs::setRombank(unsigned bank) {
-	romdata_[1] = romdata() + bank * rombank_size() - mm_rom1_begin;
+	romBank_[1] = bank;
+	romdata_[1] = romBankData(bank) - mm_rom1_begin;
 	rmem_[0x7] = rmem_[0x6] = rmem_[0x5] = rmem_[0x4] = romdata_[1];
 	disconnectOamDmaAreas();
+	remapPages(0x4, 0x8);
 }
 
 void MemPtrs::setRambank(unsigned const flags, unsigned const rambank) {
@@ -141,12 +160,14 @@ void MemPtrs::setRambank(unsigned const flags, unsigned const rambank) {
 	rmem_[0xB] = rmem_[0xA] = rsrambankptr_;
 	wmem_[0xB] = wmem_[0xA] = wsrambankptr_;
 	disconnectOamDmaAreas();
+	remapPages(0xA, 0xC);
 }
 
 void MemPtrs::setWrambank(unsigned bank) {
 	wramdata_[1] = wramdata_[0] + (bank & 0x07 ? bank & 0x07 : 1) * wrambank_size();
 	rmem_[0xD] = wmem_[0xD] = wramdata_[1] - mm_wram1_begin;
 	disconnectOamDmaAreas();
+	remapPages(0xD, 0xE);
 }
 
 void MemPtrs::setOamDmaSrc(OamDmaSrc oamDmaSrc) {
@@ -160,6 +181,7 @@ void MemPtrs::setOamDmaSrc(OamDmaSrc oamDmaSrc) {
 
 	oamDmaSrc_ = oamDmaSrc;
 	disconnectOamDmaAreas();
+	remapPages(0x0, 0xF);
 }
 
 void MemPtrs::disconnectOamDmaAreas() {
@@ -168,9 +190,98 @@ void MemPtrs::disconnectOamDmaAreas() {
 	: ::disconnectOamDmaAreas<false>(rmem_, wmem_, oamDmaSrc_);
 }
 
+// Copies the area pointers of [beginArea, endArea) to the 256-byte pages they span.
+// Any area disconnectOamDmaAreas clears outside of the range a setter updates is
+// already cleared, so a setter only needs to remap its own areas. F000-FDFF
+// echoes D000-DDFF, and is in an OAM DMA conflict area exactly when D000-DFFF is.
+// VRAM, OAM and I/O are never direct, since every access depends on LCD or OAM
+// DMA state.
+void MemPtrs::remapPages(unsigned const beginArea, unsigned const endArea) {
+	for (unsigned area = beginArea; area < endArea; ++area) {
+		std::fill_n(rpage_ + area * 0x10, 0x10, rmem_[area]);
+		std::fill_n(wpage_ + area * 0x10, 0x10, wmem_[area]);
+	}
+
+	if (beginArea <= 0xD && 0xD < endArea) {
+		unsigned const echoPages = (mm_oam_begin - 0xF000) >> 8;
+		unsigned long const echoOffset = 0xF000 - mm_wram1_begin;
+		std::fill_n(rpage_ + 0xF0, echoPages, rmem_[0xD] ? rmem_[0xD] - echoOffset : 0);
+		std::fill_n(wpage_ + 0xF0, echoPages, wmem_[0xD] ? wmem_[0xD] - echoOffset : 0);
+	}
+
+	if (numTrappedPages_) {
+		applyPageTraps(beginArea * 0x10, endArea * 0x10);
+		if (beginArea <= 0xD && 0xD < endArea)
+			applyPageTraps(0xF0, 0x100);
+	}
+}
+
+void MemPtrs::applyPageTraps(unsigned const beginPage, unsigned const endPage) {
+	for (unsigned page = beginPage; page < endPage; ++page) {
+		if (pageTraps_[page] & trap_read)
+			rpage_[page] = 0;
+		if (pageTraps_[page] & trap_write)
+			wpage_[page] = 0;
+	}
+}
+
+void MemPtrs::setPageTraps(unsigned const page, unsigned const trapFlags) {
+	if (trapFlags && !pageTraps_[page])
+		++numTrappedPages_;
+	else if (!trapFlags && pageTraps_[page])
+		--numTrappedPages_;
+
+	pageTraps_[page] = trapFlags;
+	remapPages(page >> 4, (page >> 4) + 1);
+	if (page >> 4 == 0xF)
+		remapPages(0xD, 0xE);
+}
+
 bool MemPtrs::isInOamDmaConflictArea(unsigned p) const
 {
 	return isCgb(*this)
 	? ::isInOamDmaConflictArea<true>(oamDmaSrc_, p)
 	: ::isInOamDmaConflictArea<false>(oamDmaSrc_, p);
 }
+
+void MemPtrs::patchRom(std::size_t const offset, unsigned const data) {
+	unsigned const bank = offset / rombank_size();
+	if (!romPatches_[bank]) {
+		romPatches_[bank] = new unsigned char[rombank_size()];
+		std::copy(romdata() + bank * rombank_size(), romdata() + (bank + 1) * rombank_size(),
+		          romPatches_[bank]);
+	}
+
+	romPatches_[bank][offset % rombank_size()] = data;
+	if (bank == romBank_[0])
+		setRombank0(bank);
+	if (bank == romBank_[1])
+		setRombank(bank);
+}
+
+void MemPtrs::clearRomPatches() {
+	clearPatchBanks();
+	setRombank0(romBank_[0]);
+	setRombank(romBank_[1]);
+}
+
+void MemPtrs::copyRomPatches(MemPtrs const &other) {
+	clearPatchBanks();
+	for (std::size_t bank = 0; bank < romPatches_.size(); ++bank) {
+		if (other.romPatches_[bank]) {
+			romPatches_[bank] = new unsigned char[rombank_size()];
+			std::copy(other.romPatches_[bank], other.romPatches_[bank] + rombank_size(),
+			          romPatches_[bank]);
+		}
+	}
+
+	setRombank0(romBank_[0]);
+	setRombank(romBank_[1]);
+}
+
+void MemPtrs::clearPatchBanks() {
+	for (std::size_t bank = 0; bank < romPatches_.size(); ++bank) {
+		delete[] romPatches_[bank];
+		romPatches_[bank] = 0;
+	}
+}
@@ -20,6 +20,8 @@
 #define MEMPTRS_H
 
 #include "array.h"
+#include "romimage.h"
+#include <vector>
 
 namespace gambatte {
 
@@ -52,16 +54,27 @@ inline std::size_t wrambank_size() { return 0x1000; }
 class MemPtrs {
 public:
 	enum RamFlag { read_en = 1, write_en = 2, rtc_en = 4 };
+	enum TrapFlag { trap_read = 1, trap_write = 2 };
 
 	MemPtrs();
-	void reset(unsigned rombanks, unsigned rambanks, unsigned wrambanks);
+	~MemPtrs();
+
+	/** Maps rom, taking over the reference to it, with freshly allocated RAM. */
+	void reset(RomImage *rom, unsigned rambanks, unsigned wrambanks);
 
 	unsigned char const * rmem(unsigned area) const { return rmem_[area]; }
 	unsigned char * wmem(unsigned area) const { return wmem_[area]; }
-	unsigned char * romdata() const { return memchunk_ + pre_rom_pad_size(); }
-	unsigned char * romdata(unsigned area) const { return romdata_[area]; }
-	unsigned char * romdataend() const { return rambankdata_ - max_num_vrambanks * vrambank_size(); }
-	unsigned char * vramdata() const { return romdataend(); }
+	unsigned char const * rpage(unsigned page) const { return rpage_[page]; }
+	unsigned char * wpage(unsigned page) const { return wpage_[page]; }
+	RomImage * rom() const { return rom_; }
+
+	/** The shared ROM image, without Game Genie patches. */
+	unsigned char const * romdata() const { return rom_->data(); }
+	unsigned char const * romdataend() const { return rom_->dataend(); }
+
+	unsigned char const * romdata(unsigned area) const { return romdata_[area]; }
+	unsigned romBank(unsigned area) const { return romBank_[area]; }
+	unsigned char * vramdata() const { return memchunk_; }
 	unsigned char * vramdataend() const { return rambankdata_; }
 	unsigned char * rambankdata() const { return rambankdata_; }
 	unsigned char * rambankdataend() const { return wramdata_[0]; }
@@ -81,21 +94,57 @@ public:
 	void setWrambank(unsigned bank);
 	void setOamDmaSrc(OamDmaSrc oamDmaSrc);
 
+	/**
+	  * Takes page out of the read and/or write page tables, so that accesses to it go
+	  * through the slow paths of Memory. The area tables are not affected.
+	  */
+	void setPageTraps(unsigned page, unsigned trapFlags);
+
+	/** Returns the ROM byte at offset as mapped, Game Genie patches included. */
+	unsigned romByte(std::size_t offset) const { return romBankData(offset / rombank_size())[offset % rombank_size()]; }
+
+	/**
+	  * Patches the ROM as mapped by this MemPtrs. The first patch to a bank gives it a
+	  * private copy of that bank, leaving the shared image untouched.
+	  */
+	void patchRom(std::size_t offset, unsigned data);
+
+	/** Drops all patches, mapping the shared image again. */
+	void clearRomPatches();
+
+	/** Replaces the patches with those of other, which must map the same image. */
+	void copyRomPatches(MemPtrs const &other);
+
 private:
 	unsigned char const *rmem_[0x10];
 	unsigned char       *wmem_[0x10];
-	unsigned char *romdata_[2];
+	unsigned char const *rpage_[0x100];
+	unsigned char       *wpage_[0x100];
+	unsigned char pageTraps_[0x100];
+	unsigned numTrappedPages_;
+	unsigned char const *romdata_[2];
+	unsigned romBank_[2];
 	unsigned char *wramdata_[2];
 	unsigned char *vrambankptr_;
 	unsigned char *rsrambankptr_;
 	unsigned char *wsrambankptr_;
+	RomImage *rom_;
+	std::vector<unsigned char *> romPatches_;
 	SimpleArray<unsigned char> memchunk_;
 	unsigned char *rambankdata_;
 	unsigned char *wramdataend_;
 	OamDmaSrc oamDmaSrc_;
 
-	static std::size_t pre_rom_pad_size() { return mm_rom1_begin; }
+	MemPtrs(MemPtrs const &);
+	MemPtrs & operator=(MemPtrs const &);
+	unsigned char const * romBankData(unsigned bank) const {
+		return romPatches_[bank] ? romPatches_[bank] : romdata() + bank * rombank_size();
+	}
+
+	void clearPatchBanks();
 	void disconnectOamDmaAreas();
+	void remapPages(unsigned beginArea, unsigned endArea);
+	void applyPageTraps(unsigned beginPage, unsigned endPage);
 	unsigned char * rdisabledRamw() const { return wramdataend_; }
 	unsigned char * wdisabledRam()  const { return wramdataend_ + rambank_size(); }
 };
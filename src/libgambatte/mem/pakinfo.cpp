@@ -42,6 +42,8 @@ PakInfo::PakInfo(bool multipak, unsigned rombanks, unsigned char const romheader
 }
 
 bool PakInfo::headerChecksumOk() const { return flags_ & flag_header_checksum_ok; }
+unsigned PakInfo::headerChecksum() const { return h144x_[0x14D - 0x144]; }
+unsigned PakInfo::globalChecksum() const { return h144x_[0x14E - 0x144] << 8 | h144x_[0x14F - 0x144]; }
 
 static char const * h147ToCstr(unsigned char const h147) {
 	switch (h147) {
@@ -0,0 +1,119 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "romimage.h"
+#include "../file/file.h"
+#include <cstring>
+#include <map>
+#include <pthread.h>
+
+namespace gambatte {
+
+namespace {
+
+typedef std::multimap<unsigned long, RomImage *> Registry;
+
+// shared images by content hash. only touched with registryMutex held.
+Registry registry;
+pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// only samples the start of each bank, so that sharing a large image does not
+// cost a pass over all of it on top of the comparison with its match.
+unsigned long contentHash(unsigned char const *data, unsigned banks) {
+	unsigned long h = 2166136261ul;
+	for (unsigned bank = 0; bank < banks; ++bank) {
+		for (std::size_t i = 0; i < 0x100; ++i)
+			h = ((h ^ data[bank * 0x4000ul + i]) * 16777619ul) & 0xFFFFFFFFul;
+	}
+
+	return h;
+}
+
+} // unnamed namespace.
+
+RomImage::RomImage(unsigned char const *const mapping, unsigned const banks)
+: data_(mapping ? 0 : pre_rom_pad_size + banks * 0x4000ul)
+, mapping_(mapping)
+, banks_(banks)
+, hash_(0)
+, refs_(1)
+, shared_(false)
+{
+}
+
+RomImage::~RomImage() {
+	unmapFile(mapping_, banks_ * 0x4000ul);
+}
+
+RomImage * RomImage::create(unsigned banks) {
+	return new RomImage(0, banks);
+}
+
+RomImage * RomImage::map(unsigned char const *mapping, unsigned banks) {
+	return new RomImage(mapping, banks);
+}
+
+RomImage * RomImage::share(RomImage *const image) {
+	unsigned long const hash = contentHash(image->data(), image->banks_);
+	pthread_mutex_lock(&registryMutex);
+
+	for (Registry::iterator it = registry.lower_bound(hash), end = registry.upper_bound(hash);
+			it != end; ++it) {
+		RomImage &match = *it->second;
+		if (match.banks_ == image->banks_
+				&& !std::memcmp(match.data(), image->data(), image->dataend() - image->data())) {
+			++match.refs_;
+			pthread_mutex_unlock(&registryMutex);
+			delete image;
+			return &match;
+		}
+	}
+
+	image->hash_ = hash;
+	image->shared_ = true;
+	registry.insert(Registry::value_type(hash, image));
+	pthread_mutex_unlock(&registryMutex);
+	return image;
+}
+
+RomImage * RomImage::addRef(RomImage *const image) {
+	pthread_mutex_lock(&registryMutex);
+	++image->refs_;
+	pthread_mutex_unlock(&registryMutex);
+	return image;
+}
+
+void RomImage::release(RomImage *const image) {
+	if (!image)
+		return;
+
+	pthread_mutex_lock(&registryMutex);
+	bool const last = !--image->refs_;
+	if (last && image->shared_) {
+		for (Registry::iterator it = registry.lower_bound(image->hash_);; ++it) {
+			if (it->second == image) {
+				registry.erase(it);
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&registryMutex);
+	if (last)
+		delete image;
+}
+
+}
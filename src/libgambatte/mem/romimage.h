@@ -0,0 +1,74 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef ROMIMAGE_H
+#define ROMIMAGE_H
+
+#include "array.h"
+#include "uncopyable.h"
+
+namespace gambatte {
+
+// A ROM image, padded out to whole banks. Once shared, it is immutable and
+// reference counted, and every cartridge that loads the same contents maps the
+// same image. Images are found by a hash of their contents.
+class RomImage : Uncopyable {
+public:
+	/** Returns a new, unshared image of 'banks' banks, holding one reference. */
+	static RomImage * create(unsigned banks);
+
+	/**
+	  * Returns a new, unshared image that uses the file mapping of 'banks' banks in
+	  * place, holding one reference. The image takes over the mapping.
+	  */
+	static RomImage * map(unsigned char const *mapping, unsigned banks);
+
+	/**
+	  * Takes over the reference to the unshared image, and returns a reference to a
+	  * shared image with the same contents: an existing one if there is one, in
+	  * which case image is freed, or else image itself.
+	  */
+	static RomImage * share(RomImage *image);
+
+	static RomImage * addRef(RomImage *image);
+	static void release(RomImage *image);
+
+	unsigned banks() const { return banks_; }
+	unsigned char const * data() const { return mapping_ ? mapping_ : data_ + pre_rom_pad_size; }
+	unsigned char const * dataend() const { return data() + banks_ * 0x4000ul; }
+
+	/** Storage for filling in a created image that has not been shared yet. */
+	unsigned char * buffer() { return data_ + pre_rom_pad_size; }
+
+private:
+	// lets the pointers MemPtrs derives for ROM bank 0 mapped at 0x4000 stay
+	// within the allocation of a created image.
+	enum { pre_rom_pad_size = 0x4000 };
+
+	SimpleArray<unsigned char> data_;
+	unsigned char const *mapping_;
+	unsigned banks_;
+	unsigned long hash_;
+	unsigned long refs_;
+	bool shared_;
+
+	RomImage(unsigned char const *mapping, unsigned banks);
+	~RomImage();
+};
+
+}
+
+#endif
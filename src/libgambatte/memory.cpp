@@ -17,12 +17,14 @@
 //
 
 #include "memory.h"
+#include "eventlistener.h"
 #include "inputgetter.h"
 #include "savestate.h"
 #include "sound.h"
 #include "video.h"
 
 #include <algorithm>
+#include <cstring>
 
 using namespace gambatte;
 
@@ -39,10 +41,18 @@ int serialCntFrom(unsigned long cyclesUntilDone, bool cgbFast) {
 	return cgbFast ? (cyclesUntilDone + 0xF) >> 4 : (cyclesUntilDone + 0x1FF) >> 9;
 }
 
+#ifdef GAMBATTE_TIMELINE
+char const * const eventNames[] = {
+	"unhalt", "end", "blit", "serial", "oam", "dma", "tima", "video", "interrupts"
+};
+#endif
+
 } // unnamed namespace.
 
 Memory::Memory(Interrupter const &interrupter)
 : getInput_(0)
+, eventListener_(0)
+, timeline_(*this)
 , lastOamDmaUpdate_(disabled_time)
 , lcd_(ioamhram_, 0, VideoInterruptRequester(intreq_))
 , interrupter_(interrupter)
@@ -53,9 +63,19 @@ Memory::Memory(Interrupter const &interrupter)
 , serialCnt_(0)
 , blanklcd_(false)
 , haltHdmaState_(hdma_low)
+, breakReason_(break_none)
+, breakAddress_(0)
+, breakCycles_(0)
+, runStart_(0)
+, runStartCount_(0)
+, nontrivialReads_(0)
+, nontrivialWrites_(0)
+, resumeFetch_(0x10000)
 {
+	std::fill(eventCounts_, eventCounts_ + intevent_last + 1, 0ul);
 	intreq_.setEventTime<intevent_blit>(1l * lcd_vres * lcd_cycles_per_line);
 	intreq_.setEventTime<intevent_end>(0);
+	lcd_.setTimeline(timeline_);
 }
 
 void Memory::setStatePtrs(SaveState &state) {
@@ -93,6 +113,7 @@ unsigned long Memory::saveState(SaveState &state, unsigned long cc) {
 }
 
 void Memory::loadState(SaveState const &state) {
+	resumeFetch_ = 0x10000;
 	psg_.loadState(state);
 	lcd_.loadState(state, state.mem.oamDmaPos < oam_size ? cart_.rdisabledRam() : ioamhram_);
 	tima_.loadState(state, TimaInterruptRequester(intreq_));
@@ -146,6 +167,8 @@ void Memory::setEndtime(unsigned long cc, unsigned long inc) {
 	}
 
 	intreq_.setEventTime<intevent_end>(cc + (inc << isDoubleSpeed()));
+	breakReason_ = break_none;
+	setCycleCount(cc, cycleCount(cc));
 }
 
 void Memory::updateSerial(unsigned long const cc) {
@@ -154,6 +177,11 @@ void Memory::updateSerial(unsigned long const cc) {
 			ioamhram_[0x101] = (((ioamhram_[0x101] + 1) << serialCnt_) - 1) & 0xFF;
 			ioamhram_[0x102] &= 0x7F;
 			intreq_.flagIrq(8, intreq_.eventTime(intevent_serial));
+			if (eventListener_) {
+				eventListener_->serialTransfer(cycleCount(intreq_.eventTime(intevent_serial)),
+				                               ioamhram_[0x101]);
+			}
+
 			intreq_.setEventTime<intevent_serial>(disabled_time);
 		} else {
 			int const targetCnt = serialCntFrom(intreq_.eventTime(intevent_serial) - cc,
@@ -179,7 +207,10 @@ unsigned long Memory::event(unsigned long cc) {
 	if (lastOamDmaUpdate_ != disabled_time)
 		updateOamDma(cc);
 
-	switch (intreq_.minEventId()) {
+	IntEventId const id = intreq_.minEventId();
+	TIMELINE_BEGIN(timeline_, span, cc);
+	++eventCounts_[id];
+	switch (id) {
 	case intevent_unhalt:
 		if ((lcd_.hdmaIsEnabled() && lcd_.isHdmaPeriod(cc) && haltHdmaState_ == hdma_low)
 				|| haltHdmaState_ == hdma_requested) {
@@ -206,7 +237,14 @@ unsigned long Memory::event(unsigned long cc) {
 			unsigned long blitTime = intreq_.eventTime(intevent_blit);
 
 			if (lcden | blanklcd_) {
+				// the blit is scheduled at the mode 1 irq time, which starts vblank.
+				if (eventListener_ && lcden)
+					eventListener_->vblank(cycleCount(blitTime));
+
 				lcd_.updateScreen(blanklcd_, cc);
+				if (eventListener_)
+					eventListener_->blit(cycleCount(blitTime));
+
 				intreq_.setEventTime<intevent_blit>(disabled_time);
 				intreq_.setEventTime<intevent_end>(disabled_time);
 
@@ -272,10 +310,12 @@ unsigned long Memory::event(unsigned long cc) {
 		break;
 	}
 
+	TIMELINE_END(timeline_, span, track_event, eventNames[id], cc);
 	return cc;
 }
 
 unsigned long Memory::dma(unsigned long cc) {
+	TIMELINE_BEGIN(timeline_, span, cc);
 	bool const doubleSpeed = isDoubleSpeed();
 	unsigned dmaSrc = dmaSource_;
 	unsigned dmaDest = dmaDestination_;
@@ -338,6 +378,7 @@ unsigned long Memory::dma(unsigned long cc) {
 		lcd_.disableHdma(cc);
 	}
 
+	TIMELINE_END(timeline_, span, track_dma, "vram dma", cc);
 	return cc;
 }
 
@@ -348,6 +389,8 @@ void Memory::freeze(unsigned long cc) {
 	nontrivial_ff_write(0xFF, 0, cc);
 	ackDmaReq(intreq_);
 	intreq_.halt();
+	if (eventListener_)
+		eventListener_->freeze(cycleCount(cc));
 }
 
 bool Memory::halt(unsigned long cc) {
@@ -388,6 +431,9 @@ void Memory::ackIrq(unsigned bit, unsigned long cc) {
 }
 
 unsigned long Memory::stop(unsigned long cc, bool &skip) {
+	if (eventListener_)
+		eventListener_->stop(cycleCount(cc));
+
 	// FIXME: this is incomplete.
 	intreq_.setEventTime<intevent_unhalt>(cc + 0x20000 + 4);
 
@@ -422,6 +468,7 @@ unsigned long Memory::stop(unsigned long cc, bool &skip) {
 				   ? (intreq_.eventTime(intevent_end) - cc_) * 2
 				   : (intreq_.eventTime(intevent_end) - cc_) / 2));
 		}
+		runStart_ = cc_ - (isDoubleSpeed() ? (cc_ - runStart_) * 2 : (cc_ - runStart_) / 2);
 		if (cc_ < cc + 4) {
 			if (lastOamDmaUpdate_ != disabled_time)
 				updateOamDma(cc + 4);
@@ -460,6 +507,7 @@ unsigned long Memory::resetCounters(unsigned long cc) {
 	decEventCycles(intevent_blit, dec);
 	decEventCycles(intevent_end, dec);
 	decEventCycles(intevent_unhalt, dec);
+	runStart_ -= dec;
 
 	unsigned long const oldCC = cc;
 	cc -= dec;
@@ -555,6 +603,9 @@ void Memory::endOamDma(unsigned long cc) {
 }
 
 unsigned Memory::nontrivial_ff_read(unsigned const p, unsigned long const cc) {
+	if (breakpoints_.watch(mm_io_begin + p) & Breakpoints::watch_read)
+		hitBreakpoint(break_read, mm_io_begin + p, cc);
+
 	if (lastOamDmaUpdate_ != disabled_time)
 		updateOamDma(cc);
 
@@ -617,6 +668,10 @@ unsigned Memory::nontrivial_ff_read(unsigned const p, unsigned long const cc) {
 }
 
 unsigned Memory::nontrivial_read(unsigned const p, unsigned long const cc) {
+	++nontrivialReads_;
+	if (p < mm_io_begin && (breakpoints_.watch(p) & Breakpoints::watch_read))
+		hitBreakpoint(break_read, p, cc);
+
 	if (p < mm_hram_begin) {
 		if (lastOamDmaUpdate_ != disabled_time) {
 			updateOamDma(cc);
@@ -664,6 +719,9 @@ unsigned Memory::nontrivial_read(unsigned const p, unsigned long const cc) {
 }
 
 void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long const cc) {
+	if (breakpoints_.watch(mm_io_begin + p) & Breakpoints::watch_write)
+		hitBreakpoint(break_write, mm_io_begin + p, cc);
+
 	if (lastOamDmaUpdate_ != disabled_time)
 		updateOamDma(cc);
 
@@ -1101,6 +1159,10 @@ void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long
 }
 
 void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned long const cc) {
+	++nontrivialWrites_;
+	if (p < mm_io_begin && (breakpoints_.watch(p) & Breakpoints::watch_write))
+		hitBreakpoint(break_write, p, cc);
+
 	if (lastOamDmaUpdate_ != disabled_time) {
 		updateOamDma(cc);
 
@@ -1149,6 +1211,24 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 		ioamhram_[p - mm_oam_begin] = data;
 }
 
+// a state load reconstructs the LCD and PPU mid-frame, the event times and the OAM DMA
+// progress from the saved fields, which is close but not exact. this copies them as
+// they are in m, after a load of a state saved from m at its current time.
+void Memory::copyState(Memory const &m) {
+	std::memcpy(ioamhram_, m.ioamhram_, sizeof ioamhram_);
+	lastOamDmaUpdate_ = m.lastOamDmaUpdate_;
+	intreq_ = m.intreq_;
+	tima_ = m.tima_;
+	lcd_.copyState(m.lcd_);
+	dmaSource_ = m.dmaSource_;
+	dmaDestination_ = m.dmaDestination_;
+	oamDmaPos_ = m.oamDmaPos_;
+	oamDmaStartPos_ = m.oamDmaStartPos_;
+	serialCnt_ = m.serialCnt_;
+	blanklcd_ = m.blanklcd_;
+	haltHdmaState_ = m.haltHdmaState_;
+}
+
 LoadRes Memory::loadROM(File &file, std::string const &filename, bool const forceDmg, bool const multicartCompat) {
 	if (LoadRes const fail = cart_.loadROM(file, filename, forceDmg, multicartCompat))
 		return fail;
@@ -1160,7 +1240,68 @@ LoadRes Memory::loadROM(File &file, std::string const &filename, bool const forc
 	return LOADRES_OK;
 }
 
+LoadRes Memory::loadROM(Memory const &parent, bool const forceDmg, bool const multicartCompat) {
+	if (LoadRes const fail = cart_.loadROM(parent.cart_, forceDmg, multicartCompat))
+		return fail;
+
+	psg_.init(cart_.isCgb());
+	lcd_.reset(ioamhram_, cart_.vramdata(), cart_.isCgb());
+	lcd_.copyColorSettings(parent.lcd_);
+	interrupter_.copyGameShark(parent.interrupter_);
+
+	return LOADRES_OK;
+}
+
 std::size_t Memory::fillSoundBuffer(unsigned long cc) {
 	psg_.generateSamples(cc, isDoubleSpeed());
 	return psg_.fillBuffer();
 }
+
+bool Memory::nontrivial_fetch(unsigned const p, unsigned long const cc, unsigned char &opcode) {
+	unsigned const bank = p < mm_vram_begin ? romBank(p) : 0;
+	if (p != resumeFetch_ && breakpoints_.code(bank, p)) {
+		hitBreakpoint(break_pc, p, cc);
+		resumeFetch_ = p;
+		return false;
+	}
+
+	resumeFetch_ = 0x10000;
+	opcode = read(p, cc);
+	return true;
+}
+
+int Memory::sramBank() const {
+	// rsrambankptr points at the disabled-RAM filler, or is 0 with an RTC register mapped.
+	unsigned char const *const p = cart_.rsrambankptr() + mm_sram_begin;
+	return cart_.rsrambankptr() && p >= cart_.rambankdata() && p < cart_.rambankdataend()
+	     ? static_cast<int>((p - cart_.rambankdata()) / rambank_size())
+	     : -1;
+}
+
+void Memory::hitBreakpoint(BreakReason const reason, unsigned const p, unsigned long const cc) {
+	// accesses made outside of a run (like the ones saveState makes) do not count.
+	if (!isActive() || breakReason_ != break_none)
+		return;
+
+	breakReason_ = reason;
+	breakAddress_ = p;
+	breakCycles_ = cyclesSinceRunStart(cc);
+	if (cc < intreq_.eventTime(intevent_end))
+		intreq_.setEventTime<intevent_end>(cc);
+}
+
+void Memory::setBreakpoint(unsigned const bank, unsigned const p, bool const enable) {
+	breakpoints_.setCode(bank, p & 0xFFFF, enable);
+	updatePageTraps(p & 0xFFFF);
+}
+
+void Memory::setWatchpoint(unsigned const p, unsigned const flags) {
+	breakpoints_.setWatch(p & 0xFFFF, flags & (Breakpoints::watch_read | Breakpoints::watch_write));
+	updatePageTraps(p & 0xFFFF);
+}
+
+void Memory::clearBreakpoints() {
+	breakpoints_.clear();
+	for (unsigned page = 0; page < 0x100; ++page)
+		cart_.setPageTraps(page, 0);
+}
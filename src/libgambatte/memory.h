@@ -20,16 +20,19 @@
 #define MEMORY_H
 
 #include "mem/cartridge.h"
+#include "breakpoints.h"
 #include "interrupter.h"
 #include "pakinfo.h"
 #include "sound.h"
 #include "tima.h"
+#include "timeline.h"
 #include "video.h"
 
 namespace gambatte {
 
 class File;
 class FilterInfo;
+class EventListener;
 class InputGetter;
 
 class Memory {
@@ -41,6 +44,7 @@ public:
 	void setStatePtrs(SaveState &state);
 	unsigned long saveState(SaveState &state, unsigned long cc);
 	void loadState(SaveState const &state);
+	void copyState(Memory const &m);
 	void loadSavedata() { cart_.loadSavedata(); }
 	void saveSavedata() { cart_.saveSavedata(); }
 	std::string const saveBasePath() const { return cart_.saveBasePath(); }
@@ -70,17 +74,71 @@ public:
 	unsigned pendingIrqs(unsigned long cc);
 	void ackIrq(unsigned bit, unsigned long cc);
 
+	/**
+	  * Returns a time before which reading LY is sure to give the same value it has
+	  * given since 'since', or cc if it may have changed.
+	  */
+	unsigned long lyStableUntil(unsigned long since, unsigned long cc) {
+		return lastOamDmaUpdate_ == disabled_time ? lcd_.lyRegStableUntil(since, cc) : cc;
+	}
+
 	unsigned ff_read(unsigned p, unsigned long cc) {
-		return p < 0x80 ? nontrivial_ff_read(p, cc) : ioamhram_[p + 0x100];
+		if (p < 0x80) {
+			++nontrivialReads_;
+			return nontrivial_ff_read(p, cc);
+		}
+
+		if (p == 0xFF)
+			return ieRead(cc);
+
+		return ioamhram_[p + 0x100];
 	}
 
+	unsigned char const * rmem(unsigned area) const { return cart_.rmem(area); }
+
+	/** Returns the ROM image offset of what is mapped at p, or -1 if that is not ROM. */
+	long romOffset(unsigned p) const {
+		return p < mm_vram_begin && cart_.rmem(p >> 12)
+		     ? long(romBank(p) * rombank_size() + p % rombank_size())
+		     : -1;
+	}
+
+	/** Returns the number of the ROM bank mapped at p, which must be below 0x8000. */
+	unsigned romBank(unsigned p) const { return cart_.romBank(p >> 14); }
+
 	unsigned read(unsigned p, unsigned long cc) {
-		return cart_.rmem(p >> 12) ? cart_.rmem(p >> 12)[p] : nontrivial_read(p, cc);
+		if (unsigned char const *const page = cart_.rpage(p >> 8))
+			return page[p];
+
+		if (p < mm_hram_begin)
+			return nontrivial_read(p, cc);
+
+		return p == 0xFFFF ? ieRead(cc) : ioamhram_[p - mm_oam_begin];
+	}
+
+	/**
+	  * Opcode fetch. Returns false, leaving opcode as is, if there is a breakpoint at p.
+	  * The run then ends at cc, and the next fetch from p (which would be the one that
+	  * resumes from the breakpoint) goes ahead.
+	  */
+	bool fetch(unsigned p, unsigned long cc, unsigned char &opcode) {
+		if (unsigned char const *const page = cart_.rpage(p >> 8)) {
+			opcode = page[p];
+			return true;
+		}
+
+		if (breakpoints_.hasCode())
+			return nontrivial_fetch(p, cc, opcode);
+
+		opcode = read(p, cc);
+		return true;
 	}
 
 	void write(unsigned p, unsigned data, unsigned long cc) {
-		if (cart_.wmem(p >> 12)) {
-			cart_.wmem(p >> 12)[p] = data;
+		if (unsigned char *const page = cart_.wpage(p >> 8)) {
+			page[p] = data;
+		} else if (p - mm_hram_begin < 0x7Fu) {
+			ioamhram_[p - mm_oam_begin] = data;
 		} else
 			nontrivial_write(p, data, cc);
 	}
@@ -88,18 +146,22 @@ public:
 	void ff_write(unsigned p, unsigned data, unsigned long cc) {
 		if (p - 0x80u < 0x7Fu) {
 			ioamhram_[p + 0x100] = data;
-		} else
+		} else {
+			++nontrivialWrites_;
 			nontrivial_ff_write(p, data, cc);
+		}
 	}
 
 	unsigned long event(unsigned long cycleCounter);
 	unsigned long resetCounters(unsigned long cycleCounter);
 	LoadRes loadROM(File &file, std::string const &filename, bool forceDmg, bool multicartCompat);
+	LoadRes loadROM(Memory const &parent, bool forceDmg, bool multicartCompat);
 	void setSaveDir(std::string const &dir) { cart_.setSaveDir(dir); }
 	void setInputGetter(InputGetter *getInput) { getInput_ = getInput; }
 	void setEndtime(unsigned long cc, unsigned long inc);
 	void setSoundBuffer(uint_least32_t *buf) { psg_.setBuffer(buf); }
 	std::size_t fillSoundBuffer(unsigned long cc);
+	void setAudioEnabled(bool enable) { psg_.setOutputEnabled(enable); }
 
 	void setVideoBuffer(uint_least32_t *videoBuf, std::ptrdiff_t pitch) {
 		lcd_.setVideoBuffer(videoBuf, pitch);
@@ -117,10 +179,50 @@ public:
 	void setGameShark(std::string const &codes) { interrupter_.setGameShark(codes); }
 	void updateInput();
 
+	bool hasBreakpoints() const { return breakpoints_.hasCode(); }
+	bool hasWatchpoints() const { return breakpoints_.hasWatch(); }
+	bool hasReadWatchpoints() const { return breakpoints_.hasReadWatch(); }
+	void setBreakpoint(unsigned bank, unsigned p, bool enable);
+	void setWatchpoint(unsigned p, unsigned flags);
+	void clearBreakpoints();
+	BreakReason breakReason() const { return breakReason_; }
+	unsigned breakAddress() const { return breakAddress_; }
+	unsigned long breakCycles() const { return breakCycles_; }
+	unsigned char const * wram() const { return cart_.wramdata(0); }
+	std::size_t wramSize() const { return cart_.wramdataend() - cart_.wramdata(0); }
+	unsigned wramBank() const { return (cart_.wramdata(1) - cart_.wramdata(0)) / wrambank_size(); }
+	unsigned char const * vram() const { return cart_.vramdata(); }
+	std::size_t vramSize() const { return vrambank_size() << isCgb(); }
+	unsigned vramBank() const { return ioamhram_[0x14F] & isCgb(); }
+	unsigned char const * sram() const { return cart_.rambankdata(); }
+	std::size_t sramSize() const { return cart_.rambankdataend() - cart_.rambankdata(); }
+	int sramBank() const;
+	unsigned char const * oam() const { return ioamhram_; }
+	unsigned char const * io() const { return ioamhram_ + (mm_io_begin - mm_oam_begin); }
+	unsigned char const * hram() const { return ioamhram_ + (mm_hram_begin - mm_oam_begin); }
+	bool lcdEnabled() const { return ioamhram_[0x140] & lcdc_en; }
+	unsigned long cyclesSinceRunStart(unsigned long cc) const { return (cc - runStart_) >> isDoubleSpeed(); }
+
+	/** Returns the GB::cycleCount() value at cc. */
+	unsigned long cycleCount(unsigned long cc) const { return runStartCount_ + cyclesSinceRunStart(cc); }
+	void setCycleCount(unsigned long cc, unsigned long count) { runStart_ = cc; runStartCount_ = count; }
+	void setEventListener(EventListener *listener) { eventListener_ = listener; }
+	bool startTimeline(std::string const &path) { return timeline_.start(path); }
+	void stopTimeline() { timeline_.stop(); }
+	Timeline & timeline() { return timeline_; }
+	unsigned long eventCount(IntEventId id) const { return eventCounts_[id]; }
+	unsigned long lcdEventCount() const { return lcd_.eventCount(); }
+	unsigned long ppuUpdateCount() const { return lcd_.ppuUpdateCount(); }
+	unsigned long nontrivialReads() const { return nontrivialReads_; }
+	unsigned long nontrivialWrites() const { return nontrivialWrites_; }
+	unsigned long sampleCount() const { return psg_.sampleCount(); }
+
 private:
 	Cartridge cart_;
 	unsigned char ioamhram_[0x200];
 	InputGetter *getInput_;
+	EventListener *eventListener_;
+	Timeline timeline_;
 	unsigned long lastOamDmaUpdate_;
 	InterruptRequester intreq_;
 	Tima tima_;
@@ -134,6 +236,16 @@ private:
 	unsigned char serialCnt_;
 	bool blanklcd_;
 	enum HdmaState { hdma_low, hdma_high, hdma_requested } haltHdmaState_;
+	Breakpoints breakpoints_;
+	BreakReason breakReason_;
+	unsigned breakAddress_;
+	unsigned long breakCycles_;
+	unsigned long runStart_;
+	unsigned long runStartCount_;
+	unsigned long eventCounts_[intevent_last + 1];
+	unsigned long nontrivialReads_;
+	unsigned long nontrivialWrites_;
+	unsigned resumeFetch_;
 
 	void decEventCycles(IntEventId eventId, unsigned long dec);
 	void oamDmaInitSetup();
@@ -146,6 +258,18 @@ private:
 	unsigned nontrivial_read(unsigned p, unsigned long cycleCounter);
 	void nontrivial_ff_write(unsigned p, unsigned data, unsigned long cycleCounter);
 	void nontrivial_write(unsigned p, unsigned data, unsigned long cycleCounter);
+	bool nontrivial_fetch(unsigned p, unsigned long cc, unsigned char &opcode);
+	void hitBreakpoint(BreakReason reason, unsigned p, unsigned long cc);
+
+	// IE sits right after HRAM and is read as directly, so its read watch is checked here.
+	unsigned ieRead(unsigned long cc) {
+		if (breakpoints_.watch(0xFFFF) & Breakpoints::watch_read)
+			hitBreakpoint(break_read, 0xFFFF, cc);
+
+		return ioamhram_[0x1FF];
+	}
+
+	void updatePageTraps(unsigned p) { cart_.setPageTraps(p >> 8, breakpoints_.pageTraps(p >> 8)); }
 	void updateSerial(unsigned long cc);
 	void updateTimaIrq(unsigned long cc);
 	void updateIrqs(unsigned long cc);
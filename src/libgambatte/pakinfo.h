@@ -10,6 +10,8 @@ public:
 	PakInfo();
 	PakInfo(bool multipak, unsigned rombanks, unsigned char const romheader[]);
 	bool headerChecksumOk() const;
+	unsigned headerChecksum() const;
+	unsigned globalChecksum() const;
 	std::string const mbc() const;
 	unsigned rambanks() const;
 	unsigned rombanks() const;
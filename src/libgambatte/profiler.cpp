@@ -0,0 +1,177 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "profiler.h"
+#include "mem/memptrs.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+using namespace gambatte;
+
+namespace {
+
+enum { ram_bank = 0xFFFF };
+
+void put16(std::ostream &stream, unsigned data) {
+	stream.put(data >> 8 & 0xFF);
+	stream.put(data      & 0xFF);
+}
+
+void put32(std::ostream &stream, unsigned long data) {
+	stream.put(data >> 24 & 0xFF);
+	stream.put(data >> 16 & 0xFF);
+	stream.put(data >>  8 & 0xFF);
+	stream.put(data       & 0xFF);
+}
+
+void put64(std::ostream &stream, unsigned long data) {
+	// shifted in two steps, since unsigned long may be 32 bits.
+	put32(stream, data >> 16 >> 16);
+	put32(stream, data & 0xFFFFFFFFul);
+}
+
+struct Hotspot {
+	unsigned bank;
+	unsigned pc;
+	unsigned long cycles;
+	unsigned long count;
+
+	bool operator<(Hotspot const &rhs) const { return cycles > rhs.cycles; }
+};
+
+template<class Entries>
+void addHotspots(std::vector<Hotspot> &out, Entries const &entries, unsigned bank, unsigned base) {
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].count) {
+			Hotspot const h = { bank, unsigned(base + i), entries[i].cycles, entries[i].count };
+			out.push_back(h);
+		}
+	}
+}
+
+} // unnamed namespace.
+
+Profiler::Profiler()
+: last_(0)
+, lastCc_(0)
+, enabled_(false)
+{
+	std::fill_n(opcodes_, sizeof opcodes_ / sizeof opcodes_[0], 0);
+}
+
+void Profiler::setEnabled(bool enable) {
+	enabled_ = enable;
+	last_ = 0;
+}
+
+void Profiler::reset() {
+	rom_.clear();
+	ram_.clear();
+	std::fill_n(opcodes_, sizeof opcodes_ / sizeof opcodes_[0], 0);
+	last_ = 0;
+}
+
+Profiler::Entry & Profiler::entry(unsigned const bank, unsigned const pc) {
+	Entry const none = { 0, 0 };
+	if (pc >= mm_vram_begin) {
+		if (ram_.empty())
+			ram_.resize(0x10000 - mm_vram_begin, none);
+
+		return ram_[pc - mm_vram_begin];
+	}
+
+	if (bank >= rom_.size())
+		rom_.resize(bank + 1);
+	if (rom_[bank].empty())
+		rom_[bank].resize(rombank_size(), none);
+
+	return rom_[bank][pc % rombank_size()];
+}
+
+void Profiler::write(std::ostream &stream) const {
+	std::vector<Hotspot> hotspots;
+	for (std::size_t bank = 0; bank < rom_.size(); ++bank)
+		addHotspots(hotspots, rom_[bank], bank, bank ? mm_rom1_begin : mm_rom_begin);
+
+	addHotspots(hotspots, ram_, ram_bank, mm_vram_begin);
+
+	stream.write("GBPF", 4);
+	put32(stream, 1);
+	for (std::size_t i = 0; i < sizeof opcodes_ / sizeof opcodes_[0]; ++i)
+		put64(stream, opcodes_[i]);
+
+	put32(stream, hotspots.size());
+	for (std::size_t i = 0; i < hotspots.size(); ++i) {
+		put16(stream, hotspots[i].bank);
+		put16(stream, hotspots[i].pc);
+		put64(stream, hotspots[i].cycles);
+		put64(stream, hotspots[i].count);
+	}
+}
+
+std::string const Profiler::report(std::size_t const topN) const {
+	std::vector<Hotspot> hotspots;
+	for (std::size_t bank = 0; bank < rom_.size(); ++bank)
+		addHotspots(hotspots, rom_[bank], bank, bank ? mm_rom1_begin : mm_rom_begin);
+
+	addHotspots(hotspots, ram_, ram_bank, mm_vram_begin);
+	std::sort(hotspots.begin(), hotspots.end());
+
+	double totalCycles = 0;
+	for (std::size_t i = 0; i < hotspots.size(); ++i)
+		totalCycles += hotspots[i].cycles;
+
+	std::ostringstream ss;
+	ss << std::setfill('0') << std::uppercase << std::hex;
+	ss << "address      cycles   share  executions\n";
+	for (std::size_t i = 0; i < std::min(topN, hotspots.size()); ++i) {
+		Hotspot const &h = hotspots[i];
+		if (h.bank == ram_bank)
+			ss << "   ";
+		else
+			ss << std::setw(2) << h.bank << ':';
+
+		ss << std::setw(4) << h.pc << std::dec << std::setfill(' ')
+		   << std::setw(12) << h.cycles
+		   << std::setw(7) << std::fixed << std::setprecision(2)
+		   << (totalCycles ? 100 * h.cycles / totalCycles : 0.0) << '%'
+		   << std::setw(12) << h.count << '\n'
+		   << std::setfill('0') << std::hex;
+	}
+
+	std::vector<std::pair<unsigned long, unsigned> > ops;
+	for (unsigned i = 0; i < sizeof opcodes_ / sizeof opcodes_[0]; ++i) {
+		if (opcodes_[i])
+			ops.push_back(std::make_pair(opcodes_[i], i));
+	}
+
+	std::sort(ops.rbegin(), ops.rend());
+	ss << "\nopcode  executions\n";
+	for (std::size_t i = 0; i < std::min(topN, ops.size()); ++i) {
+		if (ops[i].second >= 0x100)
+			ss << "CB " << std::setw(2) << ops[i].second - 0x100;
+		else
+			ss << "   " << std::setw(2) << ops[i].second;
+
+		ss << std::dec << std::setfill(' ') << std::setw(12) << ops[i].first << '\n'
+		   << std::setfill('0') << std::hex;
+	}
+
+	return ss.str();
+}
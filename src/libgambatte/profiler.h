@@ -0,0 +1,90 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+// Guest code profile: executions and cycles per instruction address, with ROM
+// addresses told apart by bank, and executions per opcode (0x100-0x1FF being the
+// CB-prefixed ones). An instruction is charged the cycles from the start of its
+// opcode fetch to the start of the next one, or to the next event, so interrupt
+// dispatch and halts are not charged to anything.
+//
+// The CPU only feeds it when built with GAMBATTE_PROFILER.
+class Profiler {
+public:
+	Profiler();
+	bool enabled() const { return enabled_; }
+	void setEnabled(bool enable);
+	void reset();
+
+	/** Called at the start of each instruction. cc is the time its opcode fetch started. */
+	void op(unsigned bank, unsigned pc, unsigned opcode, unsigned long cc) {
+		charge(cc);
+		Entry &e = entry(bank, pc);
+		++e.count;
+		++opcodes_[opcode];
+		last_ = &e;
+		lastCc_ = cc;
+	}
+
+	void cbOp(unsigned opcode) { ++opcodes_[0x100 + opcode]; }
+
+	/** Charges the current instruction up to cc. Called before each event. */
+	void charge(unsigned long cc) {
+		if (last_) {
+			last_->cycles += cc - lastCc_;
+			last_ = 0;
+		}
+	}
+
+	/**
+	  * Writes the profile in a flat big-endian binary format: "GBPF", a 32-bit
+	  * version (1), the 512 opcode counts as 64-bit numbers, a 32-bit record count,
+	  * then records of 16-bit bank (0xFFFF outside of ROM), 16-bit address, 64-bit
+	  * cycles and 64-bit executions, for every address that was executed.
+	  */
+	void write(std::ostream &stream) const;
+
+	/** Returns a text report of the top hotspots by cycles and the top opcodes. */
+	std::string const report(std::size_t topN) const;
+
+private:
+	struct Entry {
+		unsigned long cycles;
+		unsigned long count;
+	};
+
+	std::vector<std::vector<Entry> > rom_;
+	std::vector<Entry> ram_;
+	unsigned long opcodes_[0x200];
+	Entry *last_;
+	unsigned long lastCc_;
+	bool enabled_;
+
+	Entry & entry(unsigned bank, unsigned pc);
+};
+
+}
+
+#endif
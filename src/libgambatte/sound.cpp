@@ -49,11 +49,13 @@ using namespace gambatte;
 PSG::PSG()
 : buffer_(0)
 , bufferPos_(0)
+, sampleCount_(0)
 , lastUpdate_(0)
 , cycleCounter_(0)
 , soVol_(0)
 , rsum_(0x8000) // initialize to 0x8000 to prevent borrows from high word, xor away later
 , enabled_(false)
+, outputEnabled_(true)
 {
 }
 
@@ -136,14 +138,50 @@ inline void PSG::accumulateChannels(unsigned long const cycles) {
 	cycleCounter_ = (cc + cycles) % SoundUnit::counter_max;
 }
 
+void PSG::advanceChannels(unsigned long const cycles) {
+	unsigned long const cc = cycleCounter_;
+	ch1_.advance(cc, cc + cycles);
+	ch2_.advance(cc, cc + cycles);
+	ch3_.advance(cc, cc + cycles);
+	ch4_.advance(cc, cc + cycles);
+	cycleCounter_ = (cc + cycles) % SoundUnit::counter_max;
+}
+
 void PSG::generateSamples(unsigned long const cpuCc, bool const doubleSpeed) {
 	unsigned long const cycles = (cpuCc - lastUpdate_) >> (1 + doubleSpeed);
 	lastUpdate_ += cycles << (1 + doubleSpeed);
 
-	if (cycles)
-		accumulateChannels(cycles);
+	if (cycles) {
+		if (outputEnabled_ && buffer_)
+			accumulateChannels(cycles);
+		else
+			advanceChannels(cycles);
+	}
 
 	bufferPos_ += cycles;
+	sampleCount_ += cycles;
+}
+
+void PSG::resumeOutput() {
+	// the output units have not been kept up without output.
+	ch1_.resumeOutput(cycleCounter_);
+	ch2_.resumeOutput(cycleCounter_);
+	ch4_.resumeOutput(cycleCounter_);
+}
+
+void PSG::setBuffer(uint_least32_t *const buf) {
+	if (buf && !buffer_ && outputEnabled_)
+		resumeOutput();
+
+	buffer_ = buf;
+	bufferPos_ = 0;
+}
+
+void PSG::setOutputEnabled(bool const enable) {
+	if (enable && !outputEnabled_ && buffer_)
+		resumeOutput();
+
+	outputEnabled_ = enable;
 }
 
 void PSG::resetCounter(unsigned long newCc, unsigned long oldCc, bool doubleSpeed) {
@@ -152,6 +190,9 @@ void PSG::resetCounter(unsigned long newCc, unsigned long oldCc, bool doubleSpee
 }
 
 std::size_t PSG::fillBuffer() {
+	if (!outputEnabled_ || !buffer_)
+		return bufferPos_;
+
 	uint_least32_t sum = rsum_;
 	uint_least32_t *b = buffer_;
 	std::size_t n = bufferPos_;
@@ -40,7 +40,17 @@ public:
 	void resetCounter(unsigned long newCc, unsigned long oldCc, bool doubleSpeed);
 	void speedChange(unsigned long cc, bool doubleSpeed);
 	std::size_t fillBuffer();
-	void setBuffer(uint_least32_t *buf) { buffer_ = buf; bufferPos_ = 0; }
+	void setBuffer(uint_least32_t *buf);
+
+	/**
+	  * Without audio output (disabled, or no buffer), generateSamples only keeps the
+	  * register-visible state of the channels up to date and leaves the buffer
+	  * untouched. fillBuffer still returns the number of samples that would have
+	  * been produced.
+	  */
+	void setOutputEnabled(bool enable);
+	bool isOutputEnabled() const { return outputEnabled_; }
+	unsigned long sampleCount() const { return sampleCount_; }
 
 	bool isEnabled() const { return enabled_; }
 	void setEnabled(bool value) { enabled_ = value; }
@@ -80,13 +90,17 @@ private:
 	Channel4 ch4_;
 	uint_least32_t *buffer_;
 	std::size_t bufferPos_;
+	unsigned long sampleCount_;
 	unsigned long lastUpdate_;
 	unsigned long cycleCounter_;
 	unsigned long soVol_;
 	uint_least32_t rsum_;
 	bool enabled_;
+	bool outputEnabled_;
 
 	void accumulateChannels(unsigned long cycles);
+	void advanceChannels(unsigned long cycles);
+	void resumeOutput();
 };
 
 }
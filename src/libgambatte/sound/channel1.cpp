@@ -244,3 +244,23 @@ void Channel1::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		sweepUnit_.resetCounters(cc);
 	}
 }
+
+// Like update, but only runs the events that change register-visible state. The
+// output unit is left to catch up lazily, as when its output is static.
+void Channel1::advance(unsigned long cc, unsigned long const end) {
+	while (cc < end) {
+		unsigned long const nextMajorEvent = std::min(nextEventUnit_->counter(), end);
+		cc = nextMajorEvent;
+		if (nextEventUnit_->counter() == nextMajorEvent) {
+			nextEventUnit_->event();
+			setEvent();
+		}
+	}
+
+	if (cc >= SoundUnit::counter_max) {
+		dutyUnit_.resetCounters(cc);
+		lengthCounter_.resetCounters(cc);
+		envelopeUnit_.resetCounters(cc);
+		sweepUnit_.resetCounters(cc);
+	}
+}
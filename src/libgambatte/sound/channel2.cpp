@@ -146,3 +146,22 @@ void Channel2::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		envelopeUnit_.resetCounters(cc);
 	}
 }
+
+// Like update, but only runs the events that change register-visible state. The
+// output unit is left to catch up lazily, as when its output is static.
+void Channel2::advance(unsigned long cc, unsigned long const end) {
+	while (cc < end) {
+		unsigned long const nextMajorEvent = std::min(nextEventUnit->counter(), end);
+		cc = nextMajorEvent;
+		if (nextEventUnit->counter() == nextMajorEvent) {
+			nextEventUnit->event();
+			setEvent();
+		}
+	}
+
+	if (cc >= SoundUnit::counter_max) {
+		dutyUnit_.resetCounters(cc);
+		lengthCounter_.resetCounters(cc);
+		envelopeUnit_.resetCounters(cc);
+	}
+}
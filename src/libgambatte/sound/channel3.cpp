@@ -212,3 +212,20 @@ void Channel3::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 			waveCounter_ -= SoundUnit::counter_max;
 	}
 }
+
+// Like update, but without producing output.
+void Channel3::advance(unsigned long, unsigned long const end) {
+	while (lengthCounter_.counter() <= end) {
+		updateWaveCounter(lengthCounter_.counter());
+		lengthCounter_.event();
+	}
+
+	updateWaveCounter(end);
+
+	if (end >= SoundUnit::counter_max) {
+		lengthCounter_.resetCounters(end);
+		lastReadTime_ -= SoundUnit::counter_max;
+		if (waveCounter_ != SoundUnit::counter_disabled)
+			waveCounter_ -= SoundUnit::counter_max;
+	}
+}
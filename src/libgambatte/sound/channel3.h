@@ -45,6 +45,7 @@ public:
 	void setNr4(unsigned data, unsigned long cc);
 	void setSo(unsigned long soMask);
 	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cc, unsigned long end);
+	void advance(unsigned long cc, unsigned long end);
 
 	unsigned waveRamRead(unsigned index, unsigned long cc) const {
 		if (master_) {
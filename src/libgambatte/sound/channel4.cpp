@@ -257,3 +257,22 @@ void Channel4::update(uint_least32_t *buf, unsigned long const soBaseVol, unsign
 		envelopeUnit_.resetCounters(cc);
 	}
 }
+
+// Like update, but only runs the events that change register-visible state. The
+// output unit is left to catch up lazily, as when its output is static.
+void Channel4::advance(unsigned long cc, unsigned long const end) {
+	while (cc < end) {
+		unsigned long const nextMajorEvent = std::min(nextEventUnit_->counter(), end);
+		cc = nextMajorEvent;
+		if (nextEventUnit_->counter() == nextMajorEvent) {
+			nextEventUnit_->event();
+			setEvent();
+		}
+	}
+
+	if (cc >= SoundUnit::counter_max) {
+		lengthCounter_.resetCounters(cc);
+		lfsr_.resetCounters(cc);
+		envelopeUnit_.resetCounters(cc);
+	}
+}
@@ -39,6 +39,8 @@ public:
 	void setSo(unsigned long soMask, unsigned long cc);
 	bool isActive() const { return master_; }
 	void update(uint_least32_t *buf, unsigned long soBaseVol, unsigned long cc, unsigned long end);
+	void advance(unsigned long cc, unsigned long end);
+	void resumeOutput(unsigned long cc) { staticOutputTest_(cc); }
 	void reset(unsigned long cc);
 	void resetCc(unsigned long cc, unsigned long newCc) { lfsr_.resetCc(cc, newCc); }
 	void saveState(SaveState &state, unsigned long cc);
@@ -0,0 +1,136 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "speedhacks.h"
+#include "mem/memptrs.h"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace gambatte;
+
+namespace {
+
+// parses a hex number of exactly 'digits' digits.
+bool parseHex(std::string const &s, std::size_t digits, unsigned long &out) {
+	if (s.length() != digits)
+		return false;
+
+	out = 0;
+	for (std::size_t i = 0; i < s.length(); ++i) {
+		char const c = s[i];
+		unsigned d;
+		if (c >= '0' && c <= '9')
+			d = c - '0';
+		else if (c >= 'A' && c <= 'F')
+			d = c - 'A' + 10;
+		else if (c >= 'a' && c <= 'f')
+			d = c - 'a' + 10;
+		else
+			return false;
+
+		out = out << 4 | d;
+	}
+
+	return true;
+}
+
+bool setError(std::string *error, unsigned long lineNo, std::string const &what) {
+	if (error) {
+		std::ostringstream ss;
+		ss << "line " << lineNo << ": " << what;
+		*error = ss.str();
+	}
+
+	return false;
+}
+
+} // unnamed namespace.
+
+bool SpeedHackDb::parse(std::string const &text, std::string *const error) {
+	std::vector<IdleLoop> loops;
+	std::istringstream lines(text);
+	std::string line;
+	unsigned long lineNo = 0;
+
+	while (std::getline(lines, line)) {
+		++lineNo;
+		std::istringstream tokens(line.substr(0, line.find('#')));
+		std::string hdr, global, kind;
+		if (!(tokens >> hdr))
+			continue;
+
+		IdleLoop loop;
+		unsigned long val;
+		if (!parseHex(hdr, 2, val))
+			return setError(error, lineNo, "bad header checksum '" + hdr + "'");
+
+		loop.headerChecksum = val;
+		if (!(tokens >> global) || !parseHex(global, 4, val))
+			return setError(error, lineNo, "bad global checksum '" + global + "'");
+
+		loop.globalChecksum = val;
+		if (!(tokens >> kind) || kind != "idle")
+			return setError(error, lineNo, "unknown hint '" + kind + "'");
+
+		std::string addr;
+		std::size_t numAddrs = 0;
+		while (tokens >> addr) {
+			unsigned long bank, p;
+			// up to 4 bank digits, that is more banks than any MBC can select.
+			if (addr.length() < 6 || addr.length() > 9 || addr[addr.length() - 5] != ':'
+					|| !parseHex(addr.substr(0, addr.length() - 5), addr.length() - 5, bank)
+					|| !parseHex(addr.substr(addr.length() - 4), 4, p)) {
+				return setError(error, lineNo, "bad address '" + addr + "', expected <bank>:<address>");
+			}
+
+			if (p >= mm_vram_begin || (p < mm_rom1_begin) != (bank == 0))
+				return setError(error, lineNo, "address '" + addr + "' is not in a ROM bank it can be mapped to");
+
+			loop.romOffset = bank * rombank_size() + p % rombank_size();
+			for (std::size_t i = 0; i < loops.size(); ++i) {
+				if (loops[i].romOffset == loop.romOffset
+						&& loops[i].headerChecksum == loop.headerChecksum
+						&& loops[i].globalChecksum == loop.globalChecksum) {
+					return setError(error, lineNo, "duplicate address '" + addr + "'");
+				}
+			}
+
+			loops.push_back(loop);
+			++numAddrs;
+		}
+
+		if (!numAddrs)
+			return setError(error, lineNo, "no idle loop addresses");
+	}
+
+	idleLoops_.swap(loops);
+	return true;
+}
+
+std::vector<unsigned long> const SpeedHackDb::idleLoops(
+		unsigned const headerChecksum, unsigned const globalChecksum) const {
+	std::vector<unsigned long> offsets;
+	for (std::size_t i = 0; i < idleLoops_.size(); ++i) {
+		if (idleLoops_[i].headerChecksum == headerChecksum
+				&& idleLoops_[i].globalChecksum == globalChecksum) {
+			offsets.push_back(idleLoops_[i].romOffset);
+		}
+	}
+
+	std::sort(offsets.begin(), offsets.end());
+	return offsets;
+}
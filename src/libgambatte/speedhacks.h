@@ -0,0 +1,64 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef SPEEDHACKS_H
+#define SPEEDHACKS_H
+
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+// Per-title acceleration hints. The text format has one title per line:
+//
+//   <header checksum> <global checksum> idle <bank>:<address> [<bank>:<address> ...]
+//
+// with all numbers in hex, for instance "3C 91A2 idle 00:0255 01:4E20". Anything
+// following a '#' is a comment. Titles are identified by the header checksum byte
+// (0x14D) and the global checksum (0x14E-0x14F) of the ROM header.
+//
+// An idle address is the head of a loop in ROM that does nothing but wait for an
+// interrupt (or anything else that happens at an emulation event). The CPU checks
+// such a loop the same way as the loops it detects by itself: it has to branch back
+// to its head, fit the size limit, and do nothing but read WRAM, HRAM or LY and
+// change a and F. The only difference is that a and F need not come back around to
+// the same values, so any change to them in the skipped iterations is lost. An
+// entry that fails the checks is ignored.
+class SpeedHackDb {
+public:
+	/**
+	  * Replaces the database with the one described by text. Returns false, leaving
+	  * the database unchanged, if text is not a valid database, and sets *error (if
+	  * not 0) to a description of the first problem found.
+	  */
+	bool parse(std::string const &text, std::string *error);
+
+	/** Returns the ROM image offsets of the idle loops of a title, in ascending order. */
+	std::vector<unsigned long> const idleLoops(unsigned headerChecksum, unsigned globalChecksum) const;
+
+private:
+	struct IdleLoop {
+		unsigned long romOffset;
+		unsigned short globalChecksum;
+		unsigned char headerChecksum;
+	};
+
+	std::vector<IdleLoop> idleLoops_;
+};
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "statesnapshot.h"
+#include "cpu.h"
+#include <cstring>
+
+namespace gambatte {
+
+namespace {
+
+struct Sizer {
+	std::size_t size;
+
+	Sizer() : size(0) {}
+
+	template<typename T>
+	void operator()(SaveState::Ptr<T> const &p) { size += p.size() * sizeof(T); }
+};
+
+struct Saver {
+	unsigned char *pos;
+
+	explicit Saver(unsigned char *pos) : pos(pos) {}
+
+	template<typename T>
+	void operator()(SaveState::Ptr<T> const &p) {
+		std::memcpy(pos, p.get(), p.size() * sizeof(T));
+		pos += p.size() * sizeof(T);
+	}
+};
+
+struct Loader {
+	unsigned char const *pos;
+
+	explicit Loader(unsigned char const *pos) : pos(pos) {}
+
+	// the pointers are set by setStatePtrs and refer to the live, writable state.
+	template<typename T>
+	void operator()(SaveState::Ptr<T> const &p) {
+		std::memcpy(const_cast<T *>(p.get()), pos, p.size() * sizeof(T));
+		pos += p.size() * sizeof(T);
+	}
+};
+
+template<class F>
+void forEachPtr(SaveState const &state, F &f) {
+	f(state.mem.vram);
+	f(state.mem.sram);
+	f(state.mem.wram);
+	f(state.mem.ioamhram);
+	f(state.ppu.bgpData);
+	f(state.ppu.objpData);
+	f(state.ppu.oamReaderBuf);
+	f(state.ppu.oamReaderSzbuf);
+	f(state.spu.ch3.waveRam);
+}
+
+}
+
+void StateSnapshot::save(CPU &cpu) {
+	cpu.setStatePtrs(state_);
+	cpu.saveState(state_);
+	cycleCount_ = cpu.cycleCount();
+
+	Sizer sizer;
+	forEachPtr(state_, sizer);
+	if (data_.size() != sizer.size)
+		data_.reset(sizer.size);
+
+	Saver saver(data_);
+	forEachPtr(state_, saver);
+}
+
+void StateSnapshot::load(CPU &cpu) {
+	cpu.setStatePtrs(state_);
+	Loader loader(data_);
+	forEachPtr(state_, loader);
+
+	cpu.loadState(state_);
+	cpu.setCycleCount(cycleCount_);
+}
+
+}
@@ -0,0 +1,49 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include "array.h"
+#include "savestate.h"
+#include "uncopyable.h"
+
+namespace gambatte {
+
+class CPU;
+
+// In-memory copy of the emulator state for restoring it frame after frame, as
+// run-ahead does. Unlike StateSaver it does not go through iostreams, and its
+// buffer is only reallocated when the size of the state changes (on the first
+// save after a ROM load).
+class StateSnapshot : Uncopyable {
+public:
+	StateSnapshot() : cycleCount_(0) {}
+	void save(CPU &cpu);
+
+	// Restores the state from the last save into cpu, which must have the ROM image
+	// the save was taken with loaded: the same CPU since its last ROM load, or a fork.
+	void load(CPU &cpu);
+
+private:
+	SaveState state_;
+	Array<unsigned char> data_;
+	unsigned long cycleCount_;
+};
+
+}
+
+#endif
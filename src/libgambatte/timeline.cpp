@@ -0,0 +1,230 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "timeline.h"
+#include "memory.h"
+
+#ifdef GAMBATTE_TIMELINE
+#include <cstdio>
+#include <pthread.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+namespace gambatte {
+
+#ifdef GAMBATTE_TIMELINE
+
+namespace {
+
+enum { buffer_records = 0x4000 };
+
+double hostMicros() {
+#ifdef __APPLE__
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+
+	return mach_absolute_time() * (1.0 * timebase.numer / timebase.denom) / 1000;
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000.0 + t.tv_nsec / 1000.0;
+#endif
+}
+
+char const * const trackNames[] = { "events", "lcd", "interrupts", "dma" };
+
+// GB::cycleCount runs at 4194304 Hz in both speed modes.
+double const cycles_per_micro = 4.194304;
+
+} // unnamed namespace.
+
+struct Timeline::Flusher {
+	std::FILE *file;
+	std::vector<Record> pending;
+	double hostStart;
+	bool full;
+	bool quit;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+};
+
+Timeline::Timeline(Memory const &mem)
+: mem_(mem)
+, flusher_(0)
+{
+}
+
+Timeline::~Timeline() {
+	stop();
+}
+
+bool Timeline::start(std::string const &path) {
+	stop();
+
+	std::FILE *const file = std::fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+	std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	           "\"args\":{\"name\":\"emulated time\"}},\n", file);
+	std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,"
+	           "\"args\":{\"name\":\"host time\"}}", file);
+	for (int pid = 1; pid <= 2; ++pid) {
+		for (int track = 0; track < track_count; ++track) {
+			std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+			                   "\"args\":{\"name\":\"%s\"}}",
+			             pid, track, trackNames[track]);
+		}
+	}
+
+	Flusher *const f = new Flusher;
+	f->file = file;
+	f->pending.reserve(buffer_records);
+	f->hostStart = hostMicros();
+	f->full = false;
+	f->quit = false;
+	pthread_mutex_init(&f->mutex, 0);
+	pthread_cond_init(&f->cond, 0);
+	if (pthread_create(&f->thread, 0, flush, f)) {
+		pthread_cond_destroy(&f->cond);
+		pthread_mutex_destroy(&f->mutex);
+		std::fclose(file);
+		delete f;
+		return false;
+	}
+
+	records_.clear();
+	records_.reserve(buffer_records);
+	flusher_ = f;
+	return true;
+}
+
+void Timeline::stop() {
+	if (!flusher_)
+		return;
+
+	Flusher &f = *flusher_;
+	handOff();
+	pthread_mutex_lock(&f.mutex);
+	f.quit = true;
+	pthread_cond_broadcast(&f.cond);
+	pthread_mutex_unlock(&f.mutex);
+	pthread_join(f.thread, 0);
+
+	std::fputs("\n]}\n", f.file);
+	std::fclose(f.file);
+	pthread_cond_destroy(&f.cond);
+	pthread_mutex_destroy(&f.mutex);
+	delete flusher_;
+	flusher_ = 0;
+	records_.clear();
+}
+
+Timeline::Span const Timeline::begin(unsigned long cc) const {
+	Span const span = { hostMicros(), mem_.cycleCount(cc) };
+	return span;
+}
+
+void Timeline::end(Span const &span, Track track, char const *name, unsigned long cc) {
+	Record const r = {
+		name, span.host, hostMicros() - span.host,
+		span.cycle, mem_.cycleCount(cc) - span.cycle, track };
+	records_.push_back(r);
+	if (records_.size() == buffer_records)
+		handOff();
+}
+
+// Swaps the filled buffer with the flusher's, once it is done with the last one.
+void Timeline::handOff() {
+	Flusher &f = *flusher_;
+	pthread_mutex_lock(&f.mutex);
+	while (f.full)
+		pthread_cond_wait(&f.cond, &f.mutex);
+
+	records_.swap(f.pending);
+	f.full = true;
+	pthread_cond_broadcast(&f.cond);
+	pthread_mutex_unlock(&f.mutex);
+}
+
+void * Timeline::flush(void *const flusher) {
+	Flusher &f = *static_cast<Flusher *>(flusher);
+	pthread_mutex_lock(&f.mutex);
+	for (;;) {
+		while (!f.full && !f.quit)
+			pthread_cond_wait(&f.cond, &f.mutex);
+		if (!f.full)
+			break;
+
+		pthread_mutex_unlock(&f.mutex);
+		write(f, f.pending);
+		f.pending.clear();
+		pthread_mutex_lock(&f.mutex);
+		f.full = false;
+		pthread_cond_broadcast(&f.cond);
+	}
+
+	pthread_mutex_unlock(&f.mutex);
+	return 0;
+}
+
+// Each span goes out twice: on the emulated timeline (pid 1), where ts is
+// GB::cycleCount in microseconds, and on the host timeline (pid 2). Both carry the
+// cycle stamps as args.
+void Timeline::write(Flusher &f, std::vector<Record> const &records) {
+	for (std::size_t i = 0; i < records.size(); ++i) {
+		Record const &r = records[i];
+		std::fprintf(f.file,
+			",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"cycle\":%lu,\"cycles\":%lu}}",
+			r.name, r.track, r.cycle / cycles_per_micro, r.cycles / cycles_per_micro,
+			r.cycle, r.cycles);
+		std::fprintf(f.file,
+			",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":2,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"cycle\":%lu,\"cycles\":%lu}}",
+			r.name, r.track, r.host - f.hostStart, r.hostDuration,
+			r.cycle, r.cycles);
+	}
+}
+
+#else
+
+Timeline::Timeline(Memory const &mem)
+: mem_(mem)
+, flusher_(0)
+{
+}
+
+Timeline::~Timeline() {}
+bool Timeline::start(std::string const &) { return false; }
+void Timeline::stop() {}
+
+Timeline::Span const Timeline::begin(unsigned long cc) const {
+	Span const span = { 0, cc };
+	return span;
+}
+
+void Timeline::end(Span const &, Track, char const *, unsigned long) {}
+
+#endif
+
+}
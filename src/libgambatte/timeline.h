@@ -0,0 +1,96 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "uncopyable.h"
+#include <string>
+#include <vector>
+
+namespace gambatte {
+
+class Memory;
+
+// Emulated-timeline trace of Memory event dispatches, LCD events, interrupt
+// dispatches and DMA transfers. Each span is stamped with GB::cycleCount values
+// and host time, collected in a fixed buffer and handed to a flusher thread that
+// writes it out as Chrome trace JSON, so the emulation thread never formats or
+// does file I/O. When the flusher falls a whole buffer behind, recording waits
+// for it rather than dropping spans.
+//
+// Memory, the LCD and the interrupter only feed it when built with
+// GAMBATTE_TIMELINE, which needs POSIX threads and clocks.
+class Timeline : Uncopyable {
+public:
+	enum Track { track_event, track_lcd, track_irq, track_dma, track_count };
+
+	struct Span {
+		double host;
+		unsigned long cycle;
+	};
+
+	explicit Timeline(Memory const &mem);
+	~Timeline();
+	bool enabled() const { return flusher_ != 0; }
+
+	/** Starts writing to the file at path, finishing any current trace first. */
+	bool start(std::string const &path);
+
+	/** Writes out what is left and closes the file. */
+	void stop();
+
+	/** Starts a span at cc. Only called while enabled. */
+	Span const begin(unsigned long cc) const;
+
+	/** Ends a span at cc. name must be a string literal. Only called while enabled. */
+	void end(Span const &span, Track track, char const *name, unsigned long cc);
+
+private:
+	struct Flusher;
+	struct Record {
+		char const *name;
+		double host;
+		double hostDuration;
+		unsigned long cycle;
+		unsigned long cycles;
+		Track track;
+	};
+
+	Memory const &mem_;
+	Flusher *flusher_;
+	std::vector<Record> records_;
+
+	void handOff();
+	static void * flush(void *flusher);
+	static void write(Flusher &f, std::vector<Record> const &records);
+};
+
+}
+
+#ifdef GAMBATTE_TIMELINE
+#define TIMELINE_BEGIN(timeline, span, cc) \
+	Timeline::Span const span = (timeline).enabled() ? (timeline).begin(cc) : Timeline::Span()
+#define TIMELINE_END(timeline, span, track, name, cc) do { \
+	if ((timeline).enabled()) \
+		(timeline).end(span, Timeline::track, name, cc); \
+} while (0)
+#else
+#define TIMELINE_BEGIN(timeline, span, cc) do {} while (0)
+#define TIMELINE_END(timeline, span, track, name, cc) do {} while (0)
+#endif
+
+#endif
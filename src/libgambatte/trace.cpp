@@ -0,0 +1,80 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#include "trace.h"
+#include <ostream>
+
+using namespace gambatte;
+
+namespace {
+
+void put16(std::ostream &stream, unsigned data) {
+	stream.put(data >> 8 & 0xFF);
+	stream.put(data      & 0xFF);
+}
+
+void put32(std::ostream &stream, unsigned long data) {
+	stream.put(data >> 24 & 0xFF);
+	stream.put(data >> 16 & 0xFF);
+	stream.put(data >>  8 & 0xFF);
+	stream.put(data       & 0xFF);
+}
+
+} // unnamed namespace.
+
+void Trace::setSize(std::size_t const size) {
+	std::size_t n = size ? 1 : 0;
+	while (n < size)
+		n *= 2;
+
+	std::vector<TraceRecord>(n, TraceRecord()).swap(records_);
+	clear();
+}
+
+void Trace::sync() {
+	TraceRecord &r = records_[pos_];
+	r = TraceRecord();
+	r.cycle = lastCc_ & 0xFFFF;
+	r.pc = lastCc_ >> 16 & 0xFFFF;
+	r.bankf = trace_sync;
+	pos_ = (pos_ + 1) & (records_.size() - 1);
+	++count_;
+}
+
+void Trace::write(std::ostream &stream) const {
+	std::size_t const n = count_ < records_.size() ? count_ : records_.size();
+
+	stream.write("GBTR", 4);
+	put32(stream, 2);
+	put32(stream, n);
+	put32(stream, lastCc_ & 0xFFFFFFFFul);
+
+	for (std::size_t i = 0; i < n; ++i) {
+		TraceRecord const &r = records_[(pos_ - n + i) & (records_.size() - 1)];
+		put16(stream, r.cycle);
+		put16(stream, r.pc);
+		put16(stream, r.sp);
+		put16(stream, r.bankf);
+		stream.put(r.opcode);
+		stream.put(r.a);
+		stream.put(r.b);
+		stream.put(r.c);
+		stream.put(r.d);
+		stream.put(r.e);
+		stream.put(r.h);
+		stream.put(r.l);
+	}
+}
@@ -0,0 +1,108 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "gbint.h"
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace gambatte {
+
+// One executed instruction, as seen right after its opcode was fetched.
+// bankf holds the ROM bank of pc in bits 0-11 (trace_no_bank outside of ROM)
+// and the ZNHC flags in bits 12-15. cycle is the low 16 bits of the CPU cycle
+// counter at the start of the fetch.
+//
+// A record with bank trace_sync is not an instruction. It is put before an
+// instruction that comes 0x10000 or more cycles after the previous one (or
+// earlier, once the counter has been rebased), and holds the low 32 bits of
+// the cycle counter of that previous instruction, low half in cycle and high
+// half in pc.
+struct TraceRecord {
+	uint_least16_t cycle;
+	uint_least16_t pc;
+	uint_least16_t sp;
+	uint_least16_t bankf;
+	unsigned char opcode;
+	unsigned char a, b, c, d, e, h, l;
+};
+
+enum { trace_sync = 0xFFE, trace_no_bank = 0xFFF };
+
+// Ring buffer of the last instructions executed. Storage is only allocated by
+// setSize, so recording never allocates. The CPU only feeds it when built with
+// GAMBATTE_TRACE.
+class Trace {
+public:
+	Trace() : pos_(0), count_(0), lastCc_(0) {}
+	bool enabled() const { return !records_.empty(); }
+
+	/**
+	  * Keeps the last 'size' records, rounded up to a power of two, which is one per
+	  * instruction plus the sync records. 0 turns tracing off.
+	  */
+	void setSize(std::size_t size);
+
+	void clear() { pos_ = 0; count_ = 0; }
+
+	void record(unsigned long cc, unsigned bank, unsigned pc, unsigned sp,
+			unsigned opcode, unsigned a, unsigned f,
+			unsigned b, unsigned c, unsigned d, unsigned e, unsigned h, unsigned l) {
+		if (cc - lastCc_ > 0xFFFF && count_)
+			sync();
+
+		TraceRecord &r = records_[pos_];
+		r.cycle = cc & 0xFFFF;
+		r.pc = pc;
+		r.sp = sp;
+		r.bankf = (f & 0xF0) << 8 | bank;
+		r.opcode = opcode;
+		r.a = a;
+		r.b = b;
+		r.c = c;
+		r.d = d;
+		r.e = e;
+		r.h = h;
+		r.l = l;
+		pos_ = (pos_ + 1) & (records_.size() - 1);
+		++count_;
+		lastCc_ = cc;
+	}
+
+	/**
+	  * Writes the recorded instructions, oldest first, as big-endian binary: "GBTR",
+	  * a 32-bit version (2), a 32-bit record count, the low 32 bits of the cycle
+	  * counter of the newest record, then 16-byte records of 16-bit cycle, pc, sp and
+	  * bankf followed by opcode, a, b, c, d, e, h and l. Sync records are included.
+	  * src/tools/gbtrace.cpp decodes this.
+	  */
+	void write(std::ostream &stream) const;
+
+private:
+	std::vector<TraceRecord> records_;
+	std::size_t pos_;
+	unsigned long count_;
+	unsigned long lastCc_;
+
+	void sync();
+};
+
+}
+
+#endif
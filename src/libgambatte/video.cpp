@@ -18,9 +18,11 @@
 
 #include "video.h"
 #include "savestate.h"
+#include "timeline.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace gambatte;
 
@@ -120,6 +122,10 @@ LCD::LCD(unsigned char const *oamram, unsigned char const *vram,
 , objpData_()
 , eventTimes_(memEventRequester)
 , statReg_(0)
+, eventCount_(0)
+, ppuUpdateCount_(0)
+, timeline_(0)
+, cgbColorCorrection(0)
 {
 	for (std::size_t pno = 0; pno < sizeof dmgColorsRgb32_ / sizeof dmgColorsRgb32_[0]; ++pno)
 	for (std::size_t i = 0; i < num_palette_entries; ++i)
@@ -188,6 +194,17 @@ void LCD::loadState(SaveState const &state, unsigned char const *const oamram) {
 	refreshPalettes();
 }
 
+void LCD::copyState(LCD const &lcd) {
+	ppu_.copyState(lcd.ppu_);
+	std::memcpy(bgpData_, lcd.bgpData_, sizeof bgpData_);
+	std::memcpy(objpData_, lcd.objpData_, sizeof objpData_);
+	eventTimes_.copyTimes(lcd.eventTimes_);
+	mstatIrq_ = lcd.mstatIrq_;
+	lycIrq_ = lcd.lycIrq_;
+	nextM0Time_ = lcd.nextM0Time_;
+	statReg_ = lcd.statReg_;
+}
+
 void LCD::refreshPalettes() {
 	if (ppu_.cgb()) {
 		for (int i = 0; i < max_num_palettes * num_palette_entries; ++i) {
@@ -789,6 +806,17 @@ inline void LCD::doMode2IrqEvent() {
 	eventTimes_.setm<memevent_m2irq>(eventTimes_(memevent_m2irq) + (next << ds));
 }
 
+char const * LCD::eventName() const {
+	static char const * const memEventNames[] = {
+		"oneshot statirq", "oneshot updatewy2", "m1irq", "lycirq",
+		"spritemap", "hdma", "m2irq", "m0irq"
+	};
+
+	return eventTimes_.nextEvent() == event_mem
+		? memEventNames[eventTimes_.nextMemEvent()]
+		: "ly";
+}
+
 inline void LCD::event() {
 	switch (eventTimes_.nextEvent()) {
 	case event_mem:
@@ -859,16 +887,31 @@ void LCD::update(unsigned long const cycleCounter) {
 
 	while (cycleCounter >= eventTimes_.nextEventTime()) {
 		ppu_.update(eventTimes_.nextEventTime());
+#ifdef GAMBATTE_TIMELINE
+		unsigned long const time = eventTimes_.nextEventTime();
+		char const *const name = eventName();
+#endif
+		TIMELINE_BEGIN(*timeline_, span, time);
 		event();
+		TIMELINE_END(*timeline_, span, track_lcd, name, time);
+		++ppuUpdateCount_;
+		++eventCount_;
 	}
 
 	ppu_.update(cycleCounter);
+	++ppuUpdateCount_;
 }
 
 void LCD::setVideoBuffer(uint_least32_t *videoBuf, std::ptrdiff_t pitch) {
 	ppu_.setFrameBuf(videoBuf, pitch);
 }
 
+void LCD::copyColorSettings(LCD const &other) {
+	std::memcpy(dmgColorsRgb32_, other.dmgColorsRgb32_, sizeof dmgColorsRgb32_);
+	cgbColorCorrection = other.cgbColorCorrection;
+	refreshPalettes();
+}
+
 void LCD::setCgbColorCorrection(unsigned optNum) {
 	cgbColorCorrection = optNum;
 	refreshPalettes();
@@ -30,6 +30,8 @@
 
 namespace gambatte {
 
+class Timeline;
+
 class VideoInterruptRequester {
 public:
 	explicit VideoInterruptRequester(InterruptRequester &intreq)
@@ -54,6 +56,7 @@ public:
 	void setStatePtrs(SaveState &state);
 	void saveState(SaveState &state) const;
 	void loadState(SaveState const &state, unsigned char const *oamram);
+	void copyState(LCD const &lcd);
 	void setCgbColorCorrection(unsigned optNum);
 	void setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned long rgb32);
 	void setVideoBuffer(uint_least32_t *videoBuf, std::ptrdiff_t pitch);
@@ -133,6 +136,32 @@ public:
 		return lyReg;
 	}
 
+	/**
+	  * Returns a time before which getLyReg is sure to keep returning the value it has
+	  * been returning since 'since', or cc if it may have changed after 'since'.
+	  */
+	unsigned long lyRegStableUntil(unsigned long const since, unsigned long const cc) {
+		if (!(ppu_.lcdc() & lcdc_en))
+			return disabled_time;
+
+		if (cc >= ppu_.lyCounter().time())
+			update(cc);
+
+		unsigned long const time = ppu_.lyCounter().time();
+		if (time - since >= ppu_.lyCounter().lineTime())
+			return cc;
+
+		if (ppu_.lyCounter().ly() == lcd_lines_per_frame - 1) {
+			unsigned long const lyZeroTime = time - (2 * lcd_cycles_per_line - 2);
+			if (time - cc > 2 * lcd_cycles_per_line - 2)
+				return lyZeroTime;
+
+			return time - since <= 2 * lcd_cycles_per_line - 2 ? time : cc;
+		}
+
+		return time - cc > 10 ? time - 10 : cc;
+	}
+
 	unsigned long nextMode1IrqTime() const { return eventTimes_(memevent_m1irq); }
 	void lcdcChange(unsigned data, unsigned long cycleCounter);
 	void lcdstatChange(unsigned data, unsigned long cycleCounter);
@@ -144,6 +173,10 @@ public:
 	void update(unsigned long cycleCounter);
 	bool isCgb() const { return ppu_.cgb(); }
 	bool isDoubleSpeed() const { return ppu_.lyCounter().isDoubleSpeed(); }
+	unsigned long eventCount() const { return eventCount_; }
+	unsigned long ppuUpdateCount() const { return ppuUpdateCount_; }
+	void setTimeline(Timeline &timeline) { timeline_ = &timeline; }
+	void copyColorSettings(LCD const &other);
 
 private:
 	enum Event { event_mem,
@@ -184,6 +217,12 @@ private:
 		void setm(unsigned long time) { memEventMin_.setValue<e>(time); setMemEvent(); }
 		void set(MemEvent e, unsigned long time) { memEventMin_.setValue(e, time); setMemEvent(); }
 
+		// the interrupt requester is left alone, it refers to this instance's.
+		void copyTimes(EventTimes const &et) {
+			eventMin_ = et.eventMin_;
+			memEventMin_ = et.memEventMin_;
+		}
+
 		void flagIrq(unsigned bit) { memEventRequester_.flagIrq(bit); }
 		void flagIrq(unsigned bit, unsigned long cc) { memEventRequester_.flagIrq(bit, cc); }
 		void flagHdmaReq() { memEventRequester_.flagHdmaReq(); }
@@ -210,6 +249,9 @@ private:
 	NextM0Time nextM0Time_;
 	scoped_ptr<OsdElement> osdElement_;
 	unsigned char statReg_;
+	unsigned long eventCount_;
+	unsigned long ppuUpdateCount_;
+	Timeline *timeline_;
 	unsigned cgbColorCorrection;
 
 	static void setDmgPalette(unsigned long palette[],
@@ -221,6 +263,7 @@ private:
 		unsigned long *palette, unsigned index, unsigned data);
 	void doMode2IrqEvent();
 	void event();
+	char const * eventName() const;
 	unsigned long m0TimeOfCurrentLine(unsigned long cc);
 	unsigned long gbcToRgb32(unsigned const bgr15);
 	bool cgbpAccessible(unsigned long cycleCounter);
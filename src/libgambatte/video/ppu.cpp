@@ -346,6 +346,7 @@ namespace M3Start {
 
 namespace M3Loop {
 
+template<bool draw>
 void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	int const tileIndexSign = p.lcdc & lcdc_tdsel ? 0 : tile_pattern_table_size / tile_size / 2;
@@ -411,23 +412,35 @@ void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *const db
 			uint_least32_t *const dstend = dst + n;
 			xpos += n;
 
+			if (!draw) {
+				// only the last tile fetched is left in the state.
+				tileMapXpos += n / tile_len - 1;
+				dst = dstend - tile_len;
+			}
+
 			if (!lcdcBgEn(p)) {
-				do { *dst++ = p.bgPalette[0]; } while (dst != dstend);
-				tileMapXpos += n / (1u * tile_len);
+				if (draw) {
+					do { *dst++ = p.bgPalette[0]; } while (dst != dstend);
+				}
+
+				tileMapXpos += draw ? n / (1u * tile_len) : 1;
 
 				unsigned const tno = tileMapLine[(tileMapXpos - 1) % tile_map_len];
 				int const ts = tile_size;
 				ntileword = expand_lut[(tileDataLine + ts * tno - 2 * ts * (tno & tileIndexSign))[0]]
 				          + expand_lut[(tileDataLine + ts * tno - 2 * ts * (tno & tileIndexSign))[1]] * 2;
 			} else do {
-				dst[0] = p.bgPalette[ ntileword & tile_bpp_mask                                 ];
-				dst[1] = p.bgPalette[(ntileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
-				dst[2] = p.bgPalette[(ntileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
-				dst[3] = p.bgPalette[(ntileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
-				dst[4] = p.bgPalette[(ntileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
-				dst[5] = p.bgPalette[(ntileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
-				dst[6] = p.bgPalette[(ntileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
-				dst[7] = p.bgPalette[ ntileword                                  >> 7 * tile_bpp];
+				if (draw) {
+					dst[0] = p.bgPalette[ ntileword & tile_bpp_mask                                 ];
+					dst[1] = p.bgPalette[(ntileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
+					dst[2] = p.bgPalette[(ntileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
+					dst[3] = p.bgPalette[(ntileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
+					dst[4] = p.bgPalette[(ntileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
+					dst[5] = p.bgPalette[(ntileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
+					dst[6] = p.bgPalette[(ntileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
+					dst[7] = p.bgPalette[ ntileword                                  >> 7 * tile_bpp];
+				}
+
 				dst += tile_len;
 
 				unsigned const tno = tileMapLine[tileMapXpos % tile_map_len];
@@ -451,18 +464,21 @@ void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *const db
 			uint_least32_t *const dst = dbufline + (xpos - tile_len);
 			unsigned const tileword = -(p.lcdc & 1u * lcdc_bgen) & p.ntileword;
 
-			dst[0] = p.bgPalette[ tileword & tile_bpp_mask                                 ];
-			dst[1] = p.bgPalette[(tileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
-			dst[2] = p.bgPalette[(tileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
-			dst[3] = p.bgPalette[(tileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
-			dst[4] = p.bgPalette[(tileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
-			dst[5] = p.bgPalette[(tileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
-			dst[6] = p.bgPalette[(tileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
-			dst[7] = p.bgPalette[ tileword                                  >> 7 * tile_bpp];
+			if (draw) {
+				dst[0] = p.bgPalette[ tileword & tile_bpp_mask                                 ];
+				dst[1] = p.bgPalette[(tileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
+				dst[2] = p.bgPalette[(tileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
+				dst[3] = p.bgPalette[(tileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
+				dst[4] = p.bgPalette[(tileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
+				dst[5] = p.bgPalette[(tileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
+				dst[6] = p.bgPalette[(tileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
+				dst[7] = p.bgPalette[ tileword                                  >> 7 * tile_bpp];
+			}
 
 			int i = nextSprite - 1;
 
-			if (!lcdcObjEn(p)) {
+			// sprites end up shifted the same whether they are drawn or not.
+			if (!draw || !lcdcObjEn(p)) {
 				do {
 					int const pos = spx(p.spriteList[i]) - xpos;
 					int const sa = pos * tile_bpp >= 0
@@ -544,6 +560,7 @@ void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *const db
 	p.xpos = xpos;
 }
 
+template<bool draw>
 void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	int xpos = p.xpos;
@@ -600,17 +617,26 @@ void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *const db
 			uint_least32_t *const dstend = dst + n;
 			xpos += n;
 
+			if (!draw) {
+				// only the last tile fetched is left in the state.
+				tileMapXpos += n / tile_len - 1;
+				dst = dstend - tile_len;
+			}
+
 			do {
-				unsigned long const *const bgPalette = p.bgPalette
-					+ (nattrib & attr_cgbpalno) * num_palette_entries;
-				dst[0] = bgPalette[ ntileword & tile_bpp_mask                                 ];
-				dst[1] = bgPalette[(ntileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
-				dst[2] = bgPalette[(ntileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
-				dst[3] = bgPalette[(ntileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
-				dst[4] = bgPalette[(ntileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
-				dst[5] = bgPalette[(ntileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
-				dst[6] = bgPalette[(ntileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
-				dst[7] = bgPalette[ ntileword                                  >> 7 * tile_bpp];
+				if (draw) {
+					unsigned long const *const bgPalette = p.bgPalette
+						+ (nattrib & attr_cgbpalno) * num_palette_entries;
+					dst[0] = bgPalette[ ntileword & tile_bpp_mask                                 ];
+					dst[1] = bgPalette[(ntileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
+					dst[2] = bgPalette[(ntileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
+					dst[3] = bgPalette[(ntileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
+					dst[4] = bgPalette[(ntileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
+					dst[5] = bgPalette[(ntileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
+					dst[6] = bgPalette[(ntileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
+					dst[7] = bgPalette[ ntileword                                  >> 7 * tile_bpp];
+				}
+
 				dst += tile_len;
 
 				unsigned const tno = tileMapLine[tileMapXpos % tile_map_len                 ];
@@ -642,18 +668,22 @@ void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *const db
 			unsigned const attrib   = p.nattrib;
 			unsigned long const *const bgPalette = p.bgPalette
 				+ (attrib & attr_cgbpalno) * num_palette_entries;
-			dst[0] = bgPalette[ tileword & tile_bpp_mask                                 ];
-			dst[1] = bgPalette[(tileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
-			dst[2] = bgPalette[(tileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
-			dst[3] = bgPalette[(tileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
-			dst[4] = bgPalette[(tileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
-			dst[5] = bgPalette[(tileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
-			dst[6] = bgPalette[(tileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
-			dst[7] = bgPalette[ tileword                                  >> 7 * tile_bpp];
+
+			if (draw) {
+				dst[0] = bgPalette[ tileword & tile_bpp_mask                                 ];
+				dst[1] = bgPalette[(tileword & tile_bpp_mask << 1 * tile_bpp) >> 1 * tile_bpp];
+				dst[2] = bgPalette[(tileword & tile_bpp_mask << 2 * tile_bpp) >> 2 * tile_bpp];
+				dst[3] = bgPalette[(tileword & tile_bpp_mask << 3 * tile_bpp) >> 3 * tile_bpp];
+				dst[4] = bgPalette[(tileword & tile_bpp_mask << 4 * tile_bpp) >> 4 * tile_bpp];
+				dst[5] = bgPalette[(tileword & tile_bpp_mask << 5 * tile_bpp) >> 5 * tile_bpp];
+				dst[6] = bgPalette[(tileword & tile_bpp_mask << 6 * tile_bpp) >> 6 * tile_bpp];
+				dst[7] = bgPalette[ tileword                                  >> 7 * tile_bpp];
+			}
 
 			int i = nextSprite - 1;
 
-			if (!lcdcObjEn(p)) {
+			// sprites end up shifted the same whether they are drawn or not.
+			if (!draw || !lcdcObjEn(p)) {
 				do {
 					int const pos = spx(p.spriteList[i]) - xpos;
 					int const sa = pos * tile_bpp >= 0
@@ -774,6 +804,7 @@ void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *const db
 	p.xpos = xpos;
 }
 
+template<bool draw>
 void doFullTilesUnrolled(PPUPriv &p) {
 	int xpos = p.xpos;
 	int const xend = p.wx < p.xpos || p.wx >= xpos_end
@@ -803,15 +834,15 @@ void doFullTilesUnrolled(PPUPriv &p) {
 	if (xpos < tile_len) {
 		uint_least32_t prebuf[2 * tile_len];
 		if (p.cgb) {
-			doFullTilesUnrolledCgb(p, std::min(tile_len, xend), prebuf + (tile_len - xpos),
-			                       tileMapLine, tileline, tileMapXpos);
+			doFullTilesUnrolledCgb<draw>(p, std::min(tile_len, xend), prebuf + (tile_len - xpos),
+			                             tileMapLine, tileline, tileMapXpos);
 		} else {
-			doFullTilesUnrolledDmg(p, std::min(tile_len, xend), prebuf + (tile_len - xpos),
-			                       tileMapLine, tileline, tileMapXpos);
+			doFullTilesUnrolledDmg<draw>(p, std::min(tile_len, xend), prebuf + (tile_len - xpos),
+			                             tileMapLine, tileline, tileMapXpos);
 		}
 
 		int const newxpos = p.xpos;
-		if (newxpos > tile_len) {
+		if (draw && newxpos > tile_len) {
 			std::memcpy(dbufline, prebuf + (tile_len - xpos), (newxpos - tile_len) * sizeof *dbufline);
 		} else if (newxpos < tile_len)
 			return;
@@ -823,10 +854,12 @@ void doFullTilesUnrolled(PPUPriv &p) {
 	}
 
 	p.cgb
-	? doFullTilesUnrolledCgb(p, xend, dbufline, tileMapLine, tileline, tileMapXpos)
-	: doFullTilesUnrolledDmg(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
+	? doFullTilesUnrolledCgb<draw>(p, xend, dbufline, tileMapLine, tileline, tileMapXpos)
+	: doFullTilesUnrolledDmg<draw>(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
 }
 
+// without a frame buffer (draw is false) only the state that outlives the pixel is updated.
+template<bool draw>
 void plotPixel(PPUPriv &p) {
 	int const xpos = p.xpos;
 	unsigned const tileword = p.tileword;
@@ -842,6 +875,17 @@ void plotPixel(PPUPriv &p) {
 			p.winDrawState |= win_draw_start;
 	}
 
+	if (!draw) {
+		for (int i = static_cast<int>(p.nextSprite) - 1;
+				i >= 0 && spx(p.spriteList[i]) > xpos - tile_len; --i) {
+			p.spwordList[i] >>= tile_bpp;
+		}
+
+		p.xpos = xpos + 1;
+		p.tileword = tileword >> tile_bpp;
+		return;
+	}
+
 	unsigned const twdata = tileword & ((p.lcdc & lcdc_bgen) | p.cgb) * tile_bpp_mask;
 	unsigned long pixel = p.bgPalette[twdata + (p.attrib & attr_cgbpalno) * num_palette_entries];
 	int i = static_cast<int>(p.nextSprite) - 1;
@@ -891,6 +935,7 @@ void plotPixel(PPUPriv &p) {
 	p.tileword = tileword >> tile_bpp;
 }
 
+template<bool draw>
 void plotPixelIfNoSprite(PPUPriv &p) {
 	if (p.spriteList[p.nextSprite].spx == p.xpos) {
 		if (!(lcdcObjEn(p) | p.cgb)) {
@@ -898,10 +943,16 @@ void plotPixelIfNoSprite(PPUPriv &p) {
 				++p.nextSprite;
 			} while (p.spriteList[p.nextSprite].spx == p.xpos);
 
-			plotPixel(p);
+			plotPixel<draw>(p);
 		}
 	} else
-		plotPixel(p);
+		plotPixel<draw>(p);
+}
+
+void plotPixelIfNoSprite(PPUPriv &p) {
+	p.framebuf.fb()
+	? plotPixelIfNoSprite<true>(p)
+	: plotPixelIfNoSprite<false>(p);
 }
 
 unsigned long nextM2Time(PPUPriv const &p) {
@@ -1118,7 +1169,9 @@ namespace Tile {
 		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
 			return StartWindowDraw::f0(p);
 
-		doFullTilesUnrolled(p);
+		p.framebuf.fb()
+		? doFullTilesUnrolled<true>(p)
+		: doFullTilesUnrolled<false>(p);
 
 		if (p.xpos == xpos_end) {
 			++p.cycles;
@@ -1190,9 +1243,9 @@ namespace Tile {
 			nextCall(1, f5_, p);
 	}
 
-	void f5(PPUPriv &p) {
+	template<bool draw>
+	void plotPixels(PPUPriv &p) {
 		int endx = p.endx;
-		p.nextCallPtr = &f5_;
 
 		do {
 			if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
@@ -1209,7 +1262,7 @@ namespace Tile {
 				} while (p.spriteList[p.nextSprite].spx == p.xpos);
 			}
 
-			plotPixel(p);
+			plotPixel<draw>(p);
 
 			if (p.xpos == endx) {
 				if (endx < xpos_end) {
@@ -1221,6 +1274,13 @@ namespace Tile {
 			}
 		} while (--p.cycles >= 0);
 	}
+
+	void f5(PPUPriv &p) {
+		p.nextCallPtr = &f5_;
+		p.framebuf.fb()
+		? plotPixels<true>(p)
+		: plotPixels<false>(p);
+	}
 }
 
 } // namespace M3Loop
@@ -1690,6 +1750,42 @@ void PPU::saveState(SaveState &ss) const {
 	ss.ppu.lastM0Time = p_.now - p_.lastM0Time;
 }
 
+// copies everything but the VRAM, OAM and frame buffer pointers, which stay this PPU's own.
+void PPU::copyState(PPU const &ppu) {
+	PPUPriv const &q = ppu.p_;
+	std::memcpy(p_.bgPalette, q.bgPalette, sizeof p_.bgPalette);
+	std::memcpy(p_.spPalette, q.spPalette, sizeof p_.spPalette);
+	std::copy(q.spriteList, q.spriteList + sizeof q.spriteList / sizeof *q.spriteList, p_.spriteList);
+	std::memcpy(p_.spwordList, q.spwordList, sizeof p_.spwordList);
+	p_.nextSprite = q.nextSprite;
+	p_.currentSprite = q.currentSprite;
+	p_.nextCallPtr = q.nextCallPtr;
+	p_.now = q.now;
+	p_.lastM0Time = q.lastM0Time;
+	p_.cycles = q.cycles;
+	p_.tileword = q.tileword;
+	p_.ntileword = q.ntileword;
+	p_.spriteMapper.copyState(q.spriteMapper);
+	p_.lyCounter = q.lyCounter;
+	p_.lcdc = q.lcdc;
+	p_.scy = q.scy;
+	p_.scx = q.scx;
+	p_.wy = q.wy;
+	p_.wy2 = q.wy2;
+	p_.wx = q.wx;
+	p_.winDrawState = q.winDrawState;
+	p_.wscx = q.wscx;
+	p_.winYPos = q.winYPos;
+	p_.reg0 = q.reg0;
+	p_.reg1 = q.reg1;
+	p_.attrib = q.attrib;
+	p_.nattrib = q.nattrib;
+	p_.xpos = q.xpos;
+	p_.endx = q.endx;
+	p_.cgb = q.cgb;
+	p_.weMaster = q.weMaster;
+}
+
 void PPU::loadState(SaveState const &ss, unsigned char const *const oamram) {
 	PPUState const *const m3loopState = decodeM3LoopState(ss.ppu.state);
 	long const videoCycles = std::min(ss.ppu.videoCycles, lcd_cycles_per_frame - 1ul);
@@ -35,19 +35,23 @@ enum {
 
 class PPUFrameBuf {
 public:
-	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0) {}
+	PPUFrameBuf() : buf_(0), fbline_(nullfbline_), pitch_(0) {}
 	uint_least32_t * fb() const { return buf_; }
 	uint_least32_t * fbline() const { return fbline_; }
 	std::ptrdiff_t pitch() const { return pitch_; }
-	void setBuf(uint_least32_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
-	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline(); }
+	void setBuf(uint_least32_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline_; }
+	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline_; }
 
 private:
 	uint_least32_t *buf_;
 	uint_least32_t *fbline_;
 	std::ptrdiff_t pitch_;
+	// lines are drawn here when there is no buffer. per instance, so that
+	// instances on different threads do not write to shared memory.
+	uint_least32_t nullfbline_[lcd_hres];
 
-	static uint_least32_t * nullfbline() { static uint_least32_t nullfbline_[160]; return nullfbline_; }
+	PPUFrameBuf(PPUFrameBuf const &);
+	PPUFrameBuf & operator=(PPUFrameBuf const &);
 };
 
 struct PPUPriv;
@@ -122,6 +126,7 @@ public:
 	unsigned long lastM0Time() const { return p_.lastM0Time; }
 	unsigned lcdc() const { return p_.lcdc; }
 	void loadState(SaveState const &state, unsigned char const *oamram);
+	void copyState(PPU const &ppu);
 	LyCounter const & lyCounter() const { return p_.lyCounter; }
 	unsigned long now() const { return p_.now; }
 	void oamChange(unsigned long cc) { p_.spriteMapper.oamChange(cc); }
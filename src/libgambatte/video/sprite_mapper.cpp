@@ -22,6 +22,7 @@
 #include "../insertion_sort.h"
 
 #include <algorithm>
+#include <cstring>
 
 using namespace gambatte;
 
@@ -129,6 +130,16 @@ void SpriteMapper::OamReader::loadState(SaveState const &ss, unsigned char const
 	change(lu_);
 }
 
+// the OAM pointer is left as set by loadState, since it points into this instance's memory.
+void SpriteMapper::OamReader::copyState(OamReader const &r) {
+	std::copy(r.buf_, r.buf_ + sizeof buf_ / sizeof *buf_, buf_);
+	std::copy(r.lsbuf_, r.lsbuf_ + sizeof lsbuf_ / sizeof *lsbuf_, lsbuf_);
+	lu_ = r.lu_;
+	lastChange_ = r.lastChange_;
+	largeSpritesSrc_ = r.largeSpritesSrc_;
+	cgb_ = r.cgb_;
+}
+
 void SpriteMapper::OamReader::enableDisplay(unsigned long cc) {
 	std::fill_n(buf_, sizeof buf_ / sizeof *buf_, 0);
 	std::fill_n(lsbuf_, sizeof lsbuf_ / sizeof *lsbuf_, false);
@@ -150,6 +161,12 @@ void SpriteMapper::reset(unsigned char const *oamram, bool cgb) {
 	clearMap();
 }
 
+void SpriteMapper::copyState(SpriteMapper const &sm) {
+	std::memcpy(spritemap_, sm.spritemap_, sizeof spritemap_);
+	std::memcpy(num_, sm.num_, sizeof num_);
+	oamReader_.copyState(sm.oamReader_);
+}
+
 void SpriteMapper::clearMap() {
 	std::fill_n(num_, sizeof num_ / sizeof *num_, 1 * need_sorting_flag);
 }
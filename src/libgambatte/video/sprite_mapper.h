@@ -63,6 +63,8 @@ public:
 		mapSprites();
 	}
 
+	void copyState(SpriteMapper const &sm);
+
 	bool inactivePeriodAfterDisplayEnable(unsigned long cc) const {
 		return oamReader_.inactivePeriodAfterDisplayEnable(cc);
 	}
@@ -89,6 +91,7 @@ private:
 		void enableDisplay(unsigned long cc);
 		void saveState(SaveState &state) const { state.ppu.enableDisplayM0Time = lu_; }
 		void loadState(SaveState const &ss, unsigned char const *oamram);
+		void copyState(OamReader const &r);
 		bool inactivePeriodAfterDisplayEnable(unsigned long cc) const { return cc < lu_; }
 		unsigned lineTime() const { return lyCounter_.lineTime(); }
 
@@ -0,0 +1,113 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// Measures how fast libgambatte emulates a ROM.
+//
+// usage: gbbench [-b] [-n|-p] rom.gb [frames]
+//
+// Links against libgambatte, e.g.
+//   c++ -O2 -I../libgambatte -I.. gbbench.cpp libgambatte.a
+// Runs 'frames' frames (default 3600) after a warm-up of 60 and prints frames and
+// instructions per second, as counted by GB::stats. -b turns the block cache on,
+// -n leaves video undrawn. -p runs the ROM both ways and prints the time spent
+// drawing pixels per frame, which is what changes to the PPU pixel pipeline
+// affect. To compare two versions of the library, e.g. one built with
+// -DGAMBATTE_THREADED_DISPATCH, link against each and run both.
+
+#include "gambatte.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <vector>
+
+namespace {
+
+using gambatte::GB;
+
+double now() {
+	timeval t;
+	gettimeofday(&t, 0);
+	return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// returns the seconds taken to run 'frames' frames after the warm-up, or -1 if the
+// ROM does not load.
+double run(char const *const rom, bool const blockCache, bool const video,
+		unsigned const frames, GB::Stats &s) {
+	GB gb;
+	if (gb.load(rom))
+		return -1;
+
+	gb.setBlockCacheEnabled(blockCache);
+
+	std::vector<gambatte::uint_least32_t> videoBuf(160 * 144);
+	std::vector<gambatte::uint_least32_t> audioBuf(GB::runFramesAudioSize(60));
+	gambatte::uint_least32_t *const vbuf = video ? &videoBuf[0] : 0;
+	std::size_t samples;
+	gb.runFrames(60, vbuf, 160, 0, &audioBuf[0], samples);
+	gb.resetStats();
+
+	double const start = now();
+	for (unsigned n = 0; n < frames; n += 60)
+		gb.runFrames(frames - n < 60 ? frames - n : 60, vbuf, 160, 0, &audioBuf[0], samples);
+
+	double const t = now() - start;
+	s = gb.stats();
+	return t;
+}
+
+} // unnamed namespace.
+
+int main(int argc, char **argv) {
+	bool blockCache = false;
+	bool video = true;
+	bool ppu = false;
+	int a = 1;
+	for (; a < argc && argv[a][0] == '-'; ++a) {
+		if (std::strcmp(argv[a], "-b") == 0)
+			blockCache = true;
+		else if (std::strcmp(argv[a], "-n") == 0)
+			video = false;
+		else if (std::strcmp(argv[a], "-p") == 0)
+			ppu = true;
+		else
+			break;
+	}
+
+	if (a == argc || argc - a > 2 || (ppu && !video)) {
+		std::fprintf(stderr, "usage: gbbench [-b] [-n|-p] rom.gb [frames]\n");
+		return 1;
+	}
+
+	unsigned const frames = argc - a > 1 ? std::atoi(argv[a + 1]) : 3600;
+	GB::Stats s;
+	double const t = run(argv[a], blockCache, video, frames, s);
+	if (t < 0) {
+		std::fprintf(stderr, "%s: cannot load\n", argv[a]);
+		return 1;
+	}
+
+	std::printf("%u frames in %.3f s: %.0f frames/s, %.1f M instructions/s (%.2fx real time)\n",
+	            frames, t, frames / t, s.instructions / t / 1e6, s.cycles / t / 4194304.0);
+	if (ppu) {
+		double const undrawn = run(argv[a], blockCache, false, frames, s);
+		std::printf("undrawn: %.0f frames/s, drawing: %.1f us/frame\n",
+		            frames / undrawn, (t - undrawn) / frames * 1e6);
+	}
+
+	return 0;
+}
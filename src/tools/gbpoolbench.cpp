@@ -0,0 +1,110 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// Measures GBPool throughput against the number of worker threads.
+//
+// usage: gbpoolbench [-p] rom.gb [instances] [steps] [maxthreads]
+//
+// Links against libgambatte, e.g.
+//   c++ -O2 -I../libgambatte -I.. gbpoolbench.cpp libgambatte.a -lpthread
+// Runs 'instances' copies of the ROM (default 256) for 'steps' one-frame steps
+// (default 120) with 1, 2, 4, ... worker threads up to maxthreads (default one
+// per online CPU), and prints frames per second and the speedup over one thread.
+// -p pins workers to CPUs. Every run is checked to produce the same frames as
+// the single-threaded one.
+
+#include "gbpool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+using gambatte::GBPool;
+
+double now() {
+	timeval t;
+	gettimeofday(&t, 0);
+	return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// runs the pool and returns the seconds taken. the last video frame of every
+// instance is appended to frames.
+double run(char const *const rom, std::size_t const instances, int const steps,
+		unsigned const threads, bool const pin, std::string &frames) {
+	GBPool pool(instances, threads, pin);
+	for (std::size_t i = 0; i < instances; ++i) {
+		if (pool[i].load(rom))
+			return -1;
+
+		// vary the input a little so that the instances do not all do the same work.
+		pool.setInput(i, i % 8 == 0 ? 0x08 : 0);
+	}
+
+	double const start = now();
+	for (int s = 0; s < steps; ++s)
+		pool.step();
+
+	double const t = now() - start;
+	for (std::size_t i = 0; i < instances; ++i)
+		frames.append(reinterpret_cast<char const *>(pool.videoBuffer(i)), 160 * 144 * 4);
+
+	return t;
+}
+
+} // unnamed namespace.
+
+int main(int argc, char **argv) {
+	bool const pin = argc > 1 && std::strcmp(argv[1], "-p") == 0;
+	argv += pin;
+	argc -= pin;
+	if (argc < 2 || argc > 5) {
+		std::fprintf(stderr, "usage: gbpoolbench [-p] rom.gb [instances] [steps] [maxthreads]\n");
+		return 1;
+	}
+
+	long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	std::size_t const instances = argc > 2 ? std::atoi(argv[2]) : 256;
+	int const steps = argc > 3 ? std::atoi(argv[3]) : 120;
+	unsigned const maxthreads = argc > 4 ? std::atoi(argv[4]) : cpus > 0 ? cpus : 1;
+
+	std::string reference;
+	double base = 0;
+	std::printf("%-8s %12s %8s\n", "threads", "frames/s", "speedup");
+	for (unsigned threads = 1;; threads = threads * 2 < maxthreads ? threads * 2 : maxthreads) {
+		std::string frames;
+		double const t = run(argv[1], instances, steps, threads, pin, frames);
+		if (t < 0) {
+			std::fprintf(stderr, "%s: cannot load\n", argv[1]);
+			return 1;
+		}
+
+		if (threads == 1) {
+			reference = frames;
+			base = t;
+		}
+
+		std::printf("%-8u %12.0f %8.2f%s\n", threads, instances * steps / t, base / t,
+		            frames == reference ? "" : "  output differs from 1 thread");
+		if (threads == maxthreads)
+			break;
+	}
+
+	return 0;
+}
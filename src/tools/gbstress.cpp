@@ -0,0 +1,179 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// Runs many GB instances at once, one per thread, and checks that each produces
+// exactly what a lone instance does. Meant to be built with ThreadSanitizer to
+// catch state shared between instances.
+//
+// usage: gbstress rom.gb [threads] [frames]
+//
+// Links against libgambatte; with the library sources built into
+// libgambatte.a using the same flags, e.g.
+//   c++ -O1 -g -fsanitize=thread -I../libgambatte -I.. gbstress.cpp libgambatte.a -lpthread
+// Defaults to 64 threads and 60 frames. Every thread loads the ROM itself, half of
+// them draw video and half run without a video buffer, and all of them round-trip
+// their state through serializeState and fork part way through. Each fork is run
+// next to its parent and checked to stay identical to it, state included.
+
+#include "gambatte.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using gambatte::GB;
+
+struct Input : gambatte::InputGetter {
+	unsigned n;
+	Input() : n(0) {}
+	virtual unsigned operator()() { return ++n >> 3 & 0xFF; }
+};
+
+struct Job {
+	char const *rom;
+	int frames;
+	bool video;
+	bool sameFork;
+	std::string output;
+};
+
+std::string const state(GB &gb) {
+	std::stringstream ss;
+	gb.serializeState(ss);
+	return ss.str();
+}
+
+// the video (if drawn) and audio of every frame. half way through, gb's state goes
+// through serializeState and back, and gb is forked in the middle of a frame. from
+// then on the fork runs next to gb with a copy of its input, and sameFork is cleared
+// if their states differ right after the fork, or their video, audio or states
+// differ after any of the remaining frames. states are not compared across runs,
+// since they hold the wall-clock time of the load.
+std::string const run(char const *const rom, int const frames, bool const video, bool &sameFork) {
+	std::vector<gambatte::uint_least32_t> vbuf(160 * 144), abuf(GB::runFramesAudioSize(1));
+	std::vector<gambatte::uint_least32_t> fvbuf(160 * 144), fabuf(GB::runFramesAudioSize(1));
+	std::string out;
+	Input input;
+	Input forkInput;
+	GB gb;
+	gb.setInputGetter(&input);
+	sameFork = true;
+	if (gb.load(rom))
+		return out;
+
+	GB *fork = 0;
+	for (int frame = 0; frame < frames; ++frame) {
+		if (frame == frames / 2) {
+			std::stringstream ss;
+			gb.serializeState(ss);
+			gb.deserializeState(ss);
+
+			std::size_t samples = 12345;
+			gb.runFor(video ? &vbuf[0] : 0, 160, &abuf[0], samples);
+			out.append(reinterpret_cast<char const *>(&abuf[0]), samples * sizeof abuf[0]);
+
+			fork = gb.fork();
+			forkInput = input;
+			fork->setInputGetter(&forkInput);
+			fvbuf = vbuf;
+			sameFork = state(*fork) == state(gb);
+		}
+
+		std::size_t samples = 0;
+		gb.runFrames(1, video ? &vbuf[0] : 0, 160, 0, &abuf[0], samples);
+		if (video)
+			out.append(reinterpret_cast<char const *>(&vbuf[0]), vbuf.size() * sizeof vbuf[0]);
+
+		out.append(reinterpret_cast<char const *>(&abuf[0]), samples * sizeof abuf[0]);
+
+		if (fork) {
+			std::size_t forkSamples = 0;
+			fork->runFrames(1, video ? &fvbuf[0] : 0, 160, 0, &fabuf[0], forkSamples);
+			sameFork = sameFork && fvbuf == vbuf && forkSamples == samples
+			        && std::equal(abuf.begin(), abuf.begin() + samples, fabuf.begin())
+			        && state(*fork) == state(gb);
+		}
+	}
+
+	delete fork;
+	return out;
+}
+
+void * runJob(void *const arg) {
+	Job &job = *static_cast<Job *>(arg);
+	job.output = run(job.rom, job.frames, job.video, job.sameFork);
+	return 0;
+}
+
+} // unnamed namespace.
+
+int main(int argc, char **argv) {
+	if (argc < 2 || argc > 4) {
+		std::fprintf(stderr, "usage: %s rom.gb [threads] [frames]\n", argv[0]);
+		return 1;
+	}
+
+	int const threads = argc > 2 ? std::atoi(argv[2]) : 64;
+	int const frames = argc > 3 ? std::atoi(argv[3]) : 60;
+	bool sameFork[2];
+	std::string const reference[2] = {
+		run(argv[1], frames, false, sameFork[0]),
+		run(argv[1], frames, true, sameFork[1])
+	};
+	if (reference[0].empty()) {
+		std::fprintf(stderr, "%s: cannot load\n", argv[1]);
+		return 1;
+	}
+
+	int mismatches = 0;
+	if (!sameFork[0] || !sameFork[1]) {
+		std::printf("lone instance: fork differs from its parent\n");
+		++mismatches;
+	}
+
+	std::vector<Job> jobs(threads);
+	std::vector<pthread_t> tids(threads);
+	for (int i = 0; i < threads; ++i) {
+		jobs[i].rom = argv[1];
+		jobs[i].frames = frames;
+		jobs[i].video = i & 1;
+		if (pthread_create(&tids[i], 0, runJob, &jobs[i])) {
+			std::fprintf(stderr, "cannot start thread %d\n", i);
+			return 1;
+		}
+	}
+
+	for (int i = 0; i < threads; ++i) {
+		pthread_join(tids[i], 0);
+		if (jobs[i].output != reference[jobs[i].video]) {
+			std::printf("thread %d: output differs from a lone instance\n", i);
+			++mismatches;
+		}
+
+		if (!jobs[i].sameFork) {
+			std::printf("thread %d: fork differs from its parent\n", i);
+			++mismatches;
+		}
+	}
+
+	std::printf("%d threads, %d frames: %d mismatches\n", threads, frames, mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,232 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License version 2 for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   version 2 along with this program; if not, write to the
+//   Free Software Foundation, Inc.,
+//   51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// Decodes instruction traces written by GB::writeTrace.
+//
+// usage: gbtrace trace.bin [rom.gb]
+//
+// Standalone; build with e.g. c++ -O2 -o gbtrace gbtrace.cpp. Given the ROM
+// image, operands of instructions executed from ROM are shown as well. Operands
+// of instructions executed from RAM are not part of the trace and show as '?'.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum { sync_bank = 0xFFE, no_bank = 0xFFF };
+
+// n: 8-bit operand, nn: 16-bit operand, e: relative jump target.
+char const *const mnemonics[0x100] = {
+	"NOP",        "LD BC,nn",   "LD (BC),A",  "INC BC",   "INC B",      "DEC B",     "LD B,n",     "RLCA",
+	"LD (nn),SP", "ADD HL,BC",  "LD A,(BC)",  "DEC BC",   "INC C",      "DEC C",     "LD C,n",     "RRCA",
+	"STOP",       "LD DE,nn",   "LD (DE),A",  "INC DE",   "INC D",      "DEC D",     "LD D,n",     "RLA",
+	"JR e",       "ADD HL,DE",  "LD A,(DE)",  "DEC DE",   "INC E",      "DEC E",     "LD E,n",     "RRA",
+	"JR NZ,e",    "LD HL,nn",   "LD (HL+),A", "INC HL",   "INC H",      "DEC H",     "LD H,n",     "DAA",
+	"JR Z,e",     "ADD HL,HL",  "LD A,(HL+)", "DEC HL",   "INC L",      "DEC L",     "LD L,n",     "CPL",
+	"JR NC,e",    "LD SP,nn",   "LD (HL-),A", "INC SP",   "INC (HL)",   "DEC (HL)",  "LD (HL),n",  "SCF",
+	"JR C,e",     "ADD HL,SP",  "LD A,(HL-)", "DEC SP",   "INC A",      "DEC A",     "LD A,n",     "CCF",
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	"RET NZ",     "POP BC",     "JP NZ,nn",   "JP nn",    "CALL NZ,nn", "PUSH BC",   "ADD A,n",    "RST $00",
+	"RET Z",      "RET",        "JP Z,nn",    0,          "CALL Z,nn",  "CALL nn",   "ADC A,n",    "RST $08",
+	"RET NC",     "POP DE",     "JP NC,nn",   "-",        "CALL NC,nn", "PUSH DE",   "SUB n",      "RST $10",
+	"RET C",      "RETI",       "JP C,nn",    "-",        "CALL C,nn",  "-",         "SBC A,n",    "RST $18",
+	"LDH (n),A",  "POP HL",     "LD (C),A",   "-",        "-",          "PUSH HL",   "AND n",      "RST $20",
+	"ADD SP,n",   "JP HL",      "LD (nn),A",  "-",        "-",          "-",         "XOR n",      "RST $28",
+	"LDH A,(n)",  "POP AF",     "LD A,(C)",   "DI",       "-",          "PUSH AF",   "OR n",       "RST $30",
+	"LD HL,SP+n", "LD SP,HL",   "LD A,(nn)",  "EI",       "-",          "-",         "CP n",       "RST $38"
+};
+
+char const *const regs[8] = { "B", "C", "D", "E", "H", "L", "(HL)", "A" };
+char const *const alu[8] = { "ADD A,", "ADC A,", "SUB ", "SBC A,", "AND ", "XOR ", "OR ", "CP " };
+char const *const shifts[8] = { "RLC ", "RRC ", "RL ", "RR ", "SLA ", "SRA ", "SWAP ", "SRL " };
+
+struct Record {
+	unsigned cycle, pc, sp, bank, f;
+	unsigned opcode, a, b, c, d, e, h, l;
+};
+
+unsigned get16(unsigned char const *p) { return p[0] << 8 | p[1]; }
+
+unsigned long get32(unsigned char const *p) {
+	return static_cast<unsigned long>(get16(p)) << 16 | get16(p + 2);
+}
+
+class Rom {
+public:
+	explicit Rom(std::vector<unsigned char> const &data) : data_(data) {}
+
+	// returns the byte at pc + offset of an instruction in ROM, or -1 if unknown.
+	int byte(Record const &r, unsigned offset) const {
+		unsigned const p = r.pc + offset;
+		if (r.bank == no_bank || p >= 0x8000 || (p ^ r.pc) & 0x4000)
+			return -1;
+
+		unsigned long const i = (p < 0x4000 ? 0 : r.bank * 0x4000ul) + (p & 0x3FFF);
+		return i < data_.size() ? data_[i] : -1;
+	}
+
+private:
+	std::vector<unsigned char> const &data_;
+};
+
+std::string const hex(int value, int digits) {
+	if (value < 0)
+		return std::string(digits, '?');
+
+	char buf[16];
+	std::sprintf(buf, "%0*X", digits, value);
+	return buf;
+}
+
+std::string const disassemble(Record const &r, Rom const &rom) {
+	unsigned const op = r.opcode;
+	if (op == 0xCB) {
+		int const cb = rom.byte(r, 1);
+		if (cb < 0)
+			return "CB ??";
+
+		std::string const reg = regs[cb & 7];
+		if (cb < 0x40)
+			return shifts[cb >> 3] + reg;
+
+		char const *const bitop[3] = { "BIT ", "RES ", "SET " };
+		return bitop[(cb >> 6) - 1] + std::string(1, '0' + (cb >> 3 & 7)) + ',' + reg;
+	}
+
+	if (op == 0x76)
+		return "HALT";
+	if (op >= 0x40 && op < 0x80)
+		return std::string("LD ") + regs[op >> 3 & 7] + ',' + regs[op & 7];
+	if (op >= 0x80 && op < 0xC0)
+		return std::string(alu[op >> 3 & 7]) + regs[op & 7];
+
+	std::string const m = mnemonics[op];
+	std::string out;
+	for (std::size_t i = 0; i < m.size(); ++i) {
+		if (m.compare(i, 2, "nn") == 0) {
+			int const lo = rom.byte(r, 1), hi = rom.byte(r, 2);
+			out += '$' + hex(lo < 0 || hi < 0 ? -1 : hi << 8 | lo, 4);
+			++i;
+		} else if (m[i] == 'n') {
+			out += '$' + hex(rom.byte(r, 1), 2);
+		} else if (m[i] == 'e') {
+			int const disp = rom.byte(r, 1);
+			out += '$' + hex(disp < 0 ? -1 : (r.pc + 2 + static_cast<signed char>(disp)) & 0xFFFF, 4);
+		} else
+			out += m[i];
+	}
+
+	return out;
+}
+
+} // unnamed namespace.
+
+int main(int argc, char **argv) {
+	if (argc < 2 || argc > 3) {
+		std::fprintf(stderr, "usage: %s trace.bin [rom.gb]\n", argv[0]);
+		return 1;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	std::vector<unsigned char> const trace((std::istreambuf_iterator<char>(file)),
+	                                       std::istreambuf_iterator<char>());
+	if (trace.size() < 16 || std::memcmp(&trace[0], "GBTR", 4) != 0
+			|| get32(&trace[4]) < 1 || get32(&trace[4]) > 2) {
+		std::fprintf(stderr, "%s: not a version 1 or 2 instruction trace\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<unsigned char> romdata;
+	if (argc > 2) {
+		std::ifstream romfile(argv[2], std::ios::binary);
+		if (!romfile) {
+			std::fprintf(stderr, "%s: cannot open\n", argv[2]);
+			return 1;
+		}
+
+		romdata.assign(std::istreambuf_iterator<char>(romfile), std::istreambuf_iterator<char>());
+	}
+
+	Rom const rom(romdata);
+	unsigned long const n = get32(&trace[8]);
+	if (trace.size() < 16 + n * 16) {
+		std::fprintf(stderr, "%s: truncated\n", argv[1]);
+		return 1;
+	}
+
+	// cycle counts are reconstructed backwards from the full count of the newest
+	// record. Consecutive instructions are less than 0x10000 cycles apart unless
+	// there is a sync record between them, which holds the full count of the older.
+	std::vector<unsigned long> cycles(n);
+	unsigned long cc = get32(&trace[12]);
+	bool synced = false;
+	for (unsigned long i = n; i--;) {
+		unsigned char const *const p = &trace[16 + i * 16];
+		if ((get16(p + 6) & 0xFFF) == sync_bank) {
+			cc = static_cast<unsigned long>(get16(p + 2)) << 16 | get16(p);
+			synced = true;
+		} else if (synced) {
+			synced = false;
+		} else
+			cc = (cc - ((cc - get16(p)) & 0xFFFF)) & 0xFFFFFFFFul;
+
+		cycles[i] = cc;
+	}
+
+	std::printf("%-10s %-7s %-18s %-4s %-4s %-4s %-4s %-4s %s\n",
+	            "cycle", "address", "instruction", "AF", "BC", "DE", "HL", "SP", "flags");
+	for (unsigned long i = 0; i < n; ++i) {
+		unsigned char const *const p = &trace[16 + i * 16];
+		if ((get16(p + 6) & 0xFFF) == sync_bank)
+			continue;
+
+		Record r;
+		r.cycle = get16(p);
+		r.pc = get16(p + 2);
+		r.sp = get16(p + 4);
+		r.bank = get16(p + 6) & 0xFFF;
+		r.f = get16(p + 6) >> 8 & 0xF0;
+		r.opcode = p[8];
+		r.a = p[9];
+		r.b = p[10];
+		r.c = p[11];
+		r.d = p[12];
+		r.e = p[13];
+		r.h = p[14];
+		r.l = p[15];
+
+		std::string const bank = r.bank == no_bank ? "  " : hex(r.bank, 2);
+		std::printf("%-10lu %s:%04X %-18s %02X%02X %02X%02X %02X%02X %02X%02X %04X %c%c%c%c\n",
+		            cycles[i], bank.c_str(), r.pc, disassemble(r, rom).c_str(),
+		            r.a, r.f, r.b, r.c, r.d, r.e, r.h, r.l, r.sp,
+		            r.f & 0x80 ? 'Z' : '-', r.f & 0x40 ? 'N' : '-',
+		            r.f & 0x20 ? 'H' : '-', r.f & 0x10 ? 'C' : '-');
+	}
+
+	return 0;
+}
@@ -391,7 +391,8 @@ void writeSnapShot(std::ostream &stream, uint_least32_t const *src, std::ptrdiff
 	}
 }
 
-SaverList list;
+// built once at static initialization and only read after that.
+SaverList const list;
 
 } // anon namespace
 